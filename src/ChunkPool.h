@@ -0,0 +1,233 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "LockFreeQueue.h"
+#include "RecordingSource.h"
+
+//==============================================================================
+// Fixed-size stereo chunks of sample memory shared by recordings.
+// Chunks are only allocated on non-audio threads and handed out to the audio thread through a wait-free free list,
+// so memory grows with what is actually recorded and the audio thread never allocates. All pools of the process
+// share a fixed memory budget.
+// The free list is single-consumer: the audio thread owns it between beginAcquiring() and endAcquiring() (i.e. while
+// recording), and trim() may only take it back outside of that. Everything else works on the spare list, under the
+// mutex.
+class ChunkPool {
+public:
+    enum { chunkSize = 8192, maxChunks = 4096 };
+    static constexpr size_t memoryBudget = (size_t)512 * 1024 * 1024;
+    struct Chunk {
+        float dataL[chunkSize];
+        float dataR[chunkSize];
+    };
+
+    ChunkPool(){};
+    ~ChunkPool() { totalAllocatedBytes -= chunks.size() * sizeof(Chunk); };
+    ChunkPool(const ChunkPool &) = delete;
+
+    static int numChunksFor(int numSamples) { return (numSamples + chunkSize - 1) / chunkSize; }
+    static size_t getMemoryBudget() { return memoryBudget; }
+    static size_t getTotalAllocatedBytes() { return totalAllocatedBytes.load(); }
+
+    // non-audio thread: makes sure that `numChunks` chunks can be acquired. Returns how many of them can, which is
+    // less when the budget (or maxChunks) is reached.
+    int reserve(int numChunks) {
+        std::lock_guard<std::mutex> lock(mutex);
+        while (free.getNumReady() < numChunks) {
+            auto *chunk = takeSpare();
+            if (chunk == nullptr) {
+                break;
+            }
+            free.push(chunk);
+        }
+        return std::min(numChunks, free.getNumReady());
+    }
+    // non-audio thread: a chunk from the spare list, bypassing the free list (and its consumer)
+    Chunk *take() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return takeSpare();
+    }
+    // non-audio thread
+    void release(Chunk *chunk) {
+        std::lock_guard<std::mutex> lock(mutex);
+        spare.push_back(chunk);
+    }
+    // audio thread: marks the start and the end of the span in which acquire() is called
+    void beginAcquiring() { acquiring.store(true, std::memory_order_release); }
+    void endAcquiring() { acquiring.store(false, std::memory_order_release); }
+    // audio thread: wait-free, nullptr if nothing is reserved
+    Chunk *acquire() {
+        jassert(acquiring.load(std::memory_order_relaxed));
+        Chunk *chunk = nullptr;
+        free.pop(chunk);
+        return chunk;
+    }
+    // non-audio thread, while not acquiring: frees the chunks that are not in use (including reserved ones)
+    void trim() {
+        // the free list would have two consumers
+        jassert(!acquiring.load(std::memory_order_acquire));
+        std::lock_guard<std::mutex> lock(mutex);
+        Chunk *chunk;
+        while (free.pop(chunk)) {
+            spare.push_back(chunk);
+        }
+        std::sort(spare.begin(), spare.end());
+        auto isSpare = [&](const std::unique_ptr<Chunk> &c) {
+            return std::binary_search(spare.begin(), spare.end(), c.get());
+        };
+        chunks.erase(std::remove_if(chunks.begin(), chunks.end(), isSpare), chunks.end());
+        totalAllocatedBytes -= spare.size() * sizeof(Chunk);
+        spare.clear();
+    }
+    size_t getAllocatedBytes() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return chunks.size() * sizeof(Chunk);
+    }
+
+private:
+    inline static std::atomic<size_t> totalAllocatedBytes{0};
+
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Chunk>> chunks;
+    // released chunks, not in the free list
+    std::vector<Chunk *> spare;
+    LockFreeQueue<Chunk *, maxChunks + 1> free;
+    std::atomic<bool> acquiring{false};
+
+    Chunk *takeSpare() {
+        if (!spare.empty()) {
+            auto *chunk = spare.back();
+            spare.pop_back();
+            return chunk;
+        }
+        if ((int)chunks.size() >= maxChunks) {
+            return nullptr;
+        }
+        if (totalAllocatedBytes.fetch_add(sizeof(Chunk)) + sizeof(Chunk) > memoryBudget) {
+            totalAllocatedBytes -= sizeof(Chunk);
+            return nullptr;
+        }
+        chunks.push_back(std::make_unique<Chunk>());
+        return chunks.back().get();
+    }
+};
+
+//==============================================================================
+// Stereo recording stored in chunks of a ChunkPool.
+// The chunk table is sized on a non-audio thread before recording; the audio thread then appends without allocating
+// and publishes the length, so readers only ever touch samples that have been written. The chunks go back to the pool
+// when the recording is cleared or destroyed (on a non-audio thread).
+class ChunkedRecording : public RecordingSource {
+public:
+    ChunkedRecording(ChunkPool &pool) : pool(pool){};
+    ~ChunkedRecording() override { clear(); };
+    ChunkedRecording(const ChunkedRecording &) = delete;
+
+    int getNumSamples() const override { return numSamples.load(std::memory_order_acquire); }
+    int getCapacity() const { return capacity; }
+
+    // non-audio thread, while not being written or read: returns the chunks and makes room for `maxSamples`
+    void prepare(int maxSamples) {
+        clear();
+        chunks.assign(ChunkPool::numChunksFor(maxSamples), nullptr);
+        capacity = maxSamples;
+    }
+    // non-audio thread, while not being written or read
+    void clear() {
+        for (auto *chunk : chunks) {
+            if (chunk != nullptr) {
+                pool.release(chunk);
+            }
+        }
+        chunks.clear();
+        capacity = 0;
+        numSamples.store(0, std::memory_order_release);
+    }
+    // non-audio thread, while not being written or read: replaces the content
+    void restore(const float *sourceL, const float *sourceR, int size) {
+        prepare(size);
+        for (int pos = 0; pos < size; pos += ChunkPool::chunkSize) {
+            auto *chunk = pool.take();
+            if (chunk == nullptr) {
+                size = pos;
+                break;
+            }
+            chunks[pos / ChunkPool::chunkSize] = chunk;
+            auto length = std::min((int)ChunkPool::chunkSize, size - pos);
+            std::copy(sourceL + pos, sourceL + pos + length, chunk->dataL);
+            std::copy(sourceR + pos, sourceR + pos + length, chunk->dataR);
+        }
+        numSamples.store(size, std::memory_order_release);
+    }
+    // audio thread: returns the number of samples appended, which is less than `size` when full
+    int append(const float *sourceL, const float *sourceR, int size) {
+        int pos = numSamples.load(std::memory_order_relaxed);
+        int done = 0;
+        size = std::min(size, capacity - pos);
+        while (done < size) {
+            auto index = pos / ChunkPool::chunkSize;
+            auto offset = pos % ChunkPool::chunkSize;
+            if (chunks[index] == nullptr) {
+                chunks[index] = pool.acquire();
+                if (chunks[index] == nullptr) {
+                    break;
+                }
+            }
+            auto length = std::min(size - done, (int)ChunkPool::chunkSize - offset);
+            juce::FloatVectorOperations::copy(chunks[index]->dataL + offset, sourceL + done, length);
+            juce::FloatVectorOperations::copy(chunks[index]->dataR + offset, sourceR + done, length);
+            pos += length;
+            done += length;
+        }
+        numSamples.store(pos, std::memory_order_release);
+        return done;
+    }
+
+    void read(int start, float *destinationL, float *destinationR, int size) const override {
+        forEachSegment(start, size, [&](const float *l, const float *r, int offset, int length) {
+            if (l == nullptr) {
+                juce::FloatVectorOperations::clear(destinationL + offset, length);
+                juce::FloatVectorOperations::clear(destinationR + offset, length);
+            } else {
+                juce::FloatVectorOperations::copy(destinationL + offset, l, length);
+                juce::FloatVectorOperations::copy(destinationR + offset, r, length);
+            }
+        });
+    }
+    void addTo(int start, float *outputL, float *outputR, int size) const override {
+        forEachSegment(start, size, [&](const float *l, const float *r, int offset, int length) {
+            if (l != nullptr) {
+                juce::FloatVectorOperations::add(outputL + offset, l, length);
+                juce::FloatVectorOperations::add(outputR + offset, r, length);
+            }
+        });
+    }
+
+private:
+    ChunkPool &pool;
+    std::vector<ChunkPool::Chunk *> chunks;
+    int capacity = 0;
+    std::atomic<int> numSamples{0};
+
+    // calls f(l, r, offset, length) for each contiguous part of the range; l and r are nullptr outside the recording
+    template <typename F>
+    void forEachSegment(int start, int size, F &&f) const {
+        auto end = getNumSamples();
+        int done = 0;
+        while (done < size) {
+            int pos = start + done;
+            if (pos < 0 || pos >= end) {
+                auto length = pos < 0 ? std::min(size - done, -pos) : size - done;
+                f(nullptr, nullptr, done, length);
+                done += length;
+                continue;
+            }
+            auto *chunk = chunks[pos / ChunkPool::chunkSize];
+            auto offset = pos % ChunkPool::chunkSize;
+            auto length = std::min({size - done, (int)ChunkPool::chunkSize - offset, end - pos});
+            f(chunk->dataL + offset, chunk->dataR + offset, done, length);
+            done += length;
+        }
+    }
+};
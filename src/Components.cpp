@@ -227,8 +227,6 @@ void IncDecButton::sliderValueChanged(juce::Slider* _slider) {
 
 //==============================================================================
 StatusComponent::StatusComponent(LatestDataProvider* latestDataProvider) : latestDataProvider(latestDataProvider) {
-    latestDataProvider->addConsumer(&levelConsumer);
-
     initStatusValue(volumeValueLabel, "0.0dB", *this);
 
     initStatusKey(volumeLabel, "Peak", *this);
@@ -236,7 +234,7 @@ StatusComponent::StatusComponent(LatestDataProvider* latestDataProvider) : lates
     startTimerHz(4.0f);
 }
 
-StatusComponent::~StatusComponent() { latestDataProvider->removeConsumer(&levelConsumer); }
+StatusComponent::~StatusComponent() {}
 
 void StatusComponent::paint(juce::Graphics& g) {}
 
@@ -257,13 +255,12 @@ void StatusComponent::timerCallback() {
     } else {
         volumeValueLabel.removeColour(juce::Label::textColourId);
 
-        if (levelConsumer.ready) {
+        if (latestDataProvider->read(levelConsumer)) {
             float levelLdB = calcCurrentLevel(levelConsumer.numSamples, levelConsumer.destinationL);
             float levelRdB = calcCurrentLevel(levelConsumer.numSamples, levelConsumer.destinationR);
             auto leveldB = std::max(levelLdB, levelRdB);
             auto levelStr = (leveldB <= -100 ? "-Inf" : juce::String(leveldB, 1)) + " dB";
             volumeValueLabel.setText(levelStr, juce::dontSendNotification);
-            levelConsumer.ready = false;
             if (leveldB > 0) {
                 overflowedLevel = leveldB;
                 overflowWarning = 4 * 1.2;
@@ -328,17 +325,14 @@ void AnalyserToggle::toggleItemSelected(AnalyserToggleItem* toggleItem) {
 AnalyserWindow::AnalyserWindow(ANALYSER_MODE* analyserMode, LatestDataProvider* latestDataProvider)
     : analyserMode(analyserMode),
       latestDataProvider(latestDataProvider),
-      forwardFFT(fftOrder),
+      forwardFFT(StereoFft::create(fftOrder)),
       window(fftSize, juce::dsp::WindowingFunction<float>::hann) {
-    latestDataProvider->addConsumer(&fftConsumer);
-    latestDataProvider->addConsumer(&levelConsumer);
-
+    for (int i = 0; i < StereoFft::numChannels; i++) {
+        magnitudePointers[i] = magnitudes[i];
+    }
     startTimerHz(30.0f);
 }
-AnalyserWindow::~AnalyserWindow() {
-    latestDataProvider->removeConsumer(&fftConsumer);
-    latestDataProvider->removeConsumer(&levelConsumer);
-}
+AnalyserWindow::~AnalyserWindow() {}
 
 void AnalyserWindow::resized() {}
 void AnalyserWindow::timerCallback() {
@@ -348,15 +342,13 @@ void AnalyserWindow::timerCallback() {
     switch (*analyserMode) {
         case ANALYSER_MODE::Spectrum: {
             lastAnalyserMode = ANALYSER_MODE::Spectrum;
-            if (fftConsumer.ready) {
+            if (latestDataProvider->read(fftConsumer)) {
                 auto hasData = drawNextFrameOfSpectrum();
-                fftConsumer.ready = false;
                 readyToDrawFrame = true;
                 shouldRepaint = shouldRepaint || hasData;
             }
-            if (levelConsumer.ready) {
+            if (latestDataProvider->read(levelConsumer)) {
                 auto hasData = drawNextFrameOfLevel();
-                levelConsumer.ready = false;
                 //        readyToDrawFrame = true;
                 shouldRepaint = shouldRepaint || hasData;
             }
@@ -371,34 +363,32 @@ void AnalyserWindow::timerCallback() {
 
 bool AnalyserWindow::drawNextFrameOfSpectrum() {
     bool hasData = false;
-    for (int i = 0; i < fftSize; i++) {
-        fftData[i] = (fftData[i] + fftData[i + fftSize]) * 0.5f;
+    for (int i = 0; i < fftSize * 2; i++) {
         if (fftData[i] != 0.0f) {
             hasData = true;
+            break;
         }
-        fftData[i + fftSize] = 0;
     }
     if (!hasData) {
         return false;
     }
-    window.multiplyWithWindowingTable(fftData, fftSize);
-    forwardFFT.performFrequencyOnlyForwardTransform(fftData);
+    // the host may change the rate at any time
+    auto sampleRate = latestDataProvider->getSampleRate();
+    if (sampleRate != mappedSampleRate) {
+        frequencyMap.prepare(fftSize, sampleRate, 40.0f, 20000.0f, scopeSize);
+        mappedSampleRate = sampleRate;
+    }
+    auto* left = fftData;
+    auto* right = fftData + fftSize;
+    window.multiplyWithWindowingTable(left, fftSize);
+    window.multiplyWithWindowingTable(right, fftSize);
+    // both spectra from one transform
+    forwardFFT->performFrequencyOnlyForwardTransform(left, right, magnitudePointers);
 
-    auto sampleRate = 48000;  // TODO: ?
-    auto minFreq = 40.0f;
-    auto maxFreq = 20000.0f;
     auto mindB = -100.0f;
     auto maxdB = 0.0f;
-    for (int i = 0; i < scopeSize; ++i) {
-        float hz = xToHz(minFreq, maxFreq, (float)i / scopeSize);
-        float gain = getFFTDataByHz(fftData, fftSize, sampleRate, hz);
-        auto level = juce::jmap(juce::Decibels::gainToDecibels(gain) - juce::Decibels::gainToDecibels((float)fftSize),
-                                mindB,
-                                maxdB,
-                                0.0f,
-                                1.0f);
-        scopeData[i] = level;
-    }
+    frequencyMap.map(magnitudes[(int)StereoChannel::MID], midScopeData, mindB, maxdB);
+    frequencyMap.map(magnitudes[(int)StereoChannel::SIDE], sideScopeData, mindB, maxdB);
     return true;
 }
 bool AnalyserWindow::drawNextFrameOfLevel() {
@@ -433,7 +423,9 @@ void AnalyserWindow::paint(juce::Graphics& g) {
         auto levelWidth = 8;
         auto spectrumWidth = displayBounds.getWidth() - levelWidth * 2;
 
-        paintSpectrum(g, colour::ANALYSER_LINE, offsetX, offsetY, spectrumWidth, height, scopeData);
+        // side behind mid
+        paintSpectrum(g, colour::ANALYSER_SIDE_LINE, offsetX, offsetY, spectrumWidth, height, sideScopeData);
+        paintSpectrum(g, colour::ANALYSER_LINE, offsetX, offsetY, spectrumWidth, height, midScopeData);
         offsetX += spectrumWidth;
         paintLevel(g, offsetX, offsetY, levelWidth, height, currentLevel[0]);
         offsetX += levelWidth;
@@ -467,14 +459,18 @@ void AnalyserWindow::paintLevel(juce::Graphics& g, int offsetX, int offsetY, int
 AnalyserWindow2::AnalyserWindow2(Recorder& recorder, AllParams& allParams)
     : recorder(recorder),
       allParams(allParams),
-      forwardFFT(FFT_ORDER),
-      window(FFT_SIZE, juce::dsp::WindowingFunction<float>::hann),
+      spectrogram(getSpectrogramSpec(0, TIME_SCOPE_SIZE)),
+      snapshot(recorder.getSnapshot(recorder.getCurrentEntryIndex())),
       envelopeLine{colour::ENVELOPE_LINE},
       spectrumLine{colour::SPECTRUM_LINE},
       entryButtons{juce::ToggleButton{"1"}, juce::ToggleButton{"2"}, juce::ToggleButton{"3"}, juce::ToggleButton{"4"}},
       recordButton{"Record"},
       playButton{"Play"},
       stopButton{"Stop"},
+      clearButton{"Clear"},
+      diskButton{"Disk"},
+      iirButton{"IIR"},
+      autoOrderButton{"Auto N"},
       highFreqGrip{Colours::brown, false},
       lowFreqGrip(Colours::blueviolet, false),
       highFreqMask{Colour::fromRGBA(255, 255, 255, 127)},
@@ -495,6 +491,30 @@ AnalyserWindow2::AnalyserWindow2(Recorder& recorder, AllParams& allParams)
     stopButton.setLookAndFeel(&seedLookAndFeel);
     stopButton.addListener(this);
     addAndMakeVisible(stopButton);
+    clearButton.setLookAndFeel(&seedLookAndFeel);
+    clearButton.addListener(this);
+    addAndMakeVisible(clearButton);
+    diskButton.setLookAndFeel(&seedLookAndFeel);
+    diskButton.setToggleState(allParams.RecToDisk->get(), juce::dontSendNotification);
+    diskButton.addListener(this);
+    addAndMakeVisible(diskButton);
+    iirButton.setLookAndFeel(&seedLookAndFeel);
+    iirButton.setToggleState(allParams.FilterMode->getIndex() == 1, juce::dontSendNotification);
+    iirButton.addListener(this);
+    addAndMakeVisible(iirButton);
+    autoOrderButton.setLookAndFeel(&seedLookAndFeel);
+    autoOrderButton.setToggleState(allParams.FilterAuto->get(), juce::dontSendNotification);
+    autoOrderButton.addListener(this);
+    addAndMakeVisible(autoOrderButton);
+    filterInfoLabel.setJustificationType(juce::Justification::centredLeft);
+    filterInfoLabel.setInterceptsMouseClicks(false, false);
+    addAndMakeVisible(filterInfoLabel);
+    memoryLabel.setJustificationType(juce::Justification::centredRight);
+    memoryLabel.setInterceptsMouseClicks(false, false);
+    addAndMakeVisible(memoryLabel);
+    spectrogramInfoLabel.setJustificationType(juce::Justification::centredRight);
+    spectrogramInfoLabel.setInterceptsMouseClicks(false, false);
+    addAndMakeVisible(spectrogramInfoLabel);
     {
         auto image = juce::Image{juce::Image::PixelFormat::RGB, TIME_SCOPE_SIZE, FREQ_SCOPE_SIZE, true};
         heatMap.setImage(image);
@@ -545,8 +565,15 @@ void AnalyserWindow2::resized() {
     recordButton.setBounds(toolsArea.removeFromLeft(100));
     playButton.setBounds(toolsArea.removeFromLeft(100));
     stopButton.setBounds(toolsArea.removeFromLeft(100));
+    clearButton.setBounds(toolsArea.removeFromLeft(100));
+    diskButton.setBounds(toolsArea.removeFromLeft(70));
+    toolsArea.removeFromLeft(20);
+    iirButton.setBounds(toolsArea.removeFromLeft(70));
+    autoOrderButton.setBounds(toolsArea.removeFromLeft(100));
+    memoryLabel.setBounds(toolsArea.removeFromRight(200));
+    filterInfoLabel.setBounds(toolsArea);
 
-    inner.removeFromTop(30);
+    spectrogramInfoLabel.setBounds(inner.removeFromTop(30).removeFromRight(300));
 
     float width = inner.getWidth();
     float height = inner.getHeight();
@@ -563,12 +590,49 @@ void AnalyserWindow2::timerCallback() {
     int currentEntryIndex = recorder.getCurrentEntryIndex();
     bool canOperate = recorder.canOperate();
 
-    if (!calculated && canOperate) {
-        for (int t = 0; t < TIME_SCOPE_SIZE; ++t) {
-            calculateSpectrum(t);
+    snapshot = recorder.getSnapshot(currentEntryIndex);
+    isLive = recorder.getLiveTake(currentEntryIndex, liveTake);
+    // a take recorded to the end keeps the generation (and the columns) of its live take
+    auto generation = isLive ? liveTake.generation : snapshot->generation;
+    auto length = isLive ? liveTake.length : snapshot->getNumSamples();
+    auto spec = getSpectrogramSpec(length, heatMap.getWidth() > 0 ? heatMap.getWidth() : TIME_SCOPE_SIZE);
+    if (generation != calculatedGeneration || spec != spectrogram.getSpec()) {
+        // the heat map is drawn from the levels that are about to be replaced
+        heatMapRenderer.cancel();
+        if (spec != spectrogram.getSpec()) {
+            spectrogram.configure(spec);
         }
-        calculated = true;
-        drawHeatMap();
+        // calculated in the background and drawn as the columns come in, unless the entry has not changed since
+        if (isLive) {
+            spectrogram.start(liveTake.storage, liveTake.sampleRate, liveTake.length);
+        } else if (!spectrogram.restoreFrom(cachedSpectrograms[currentEntryIndex], generation, snapshot->sampleRate)) {
+            spectrogram.start(snapshot, snapshot->sampleRate);
+        }
+        calculatedGeneration = generation;
+        numDrawnColumns = -1;
+        numRenderedColumns = -1;
+        // the previous snapshot may have been the last reference to a take
+        recorder.releaseUnusedMemory();
+    }
+    // the columns recorded since the last time
+    spectrogram.update();
+    auto numReadyColumns = spectrogram.getNumReady();
+    auto& cached = cachedSpectrograms[currentEntryIndex];
+    auto isCached = cached.generation == calculatedGeneration && cached.spec == spec;
+    if (!isLive && numReadyColumns == spec.numColumns && !isCached) {
+        spectrogram.saveTo(cached, calculatedGeneration);
+    }
+    juce::Image renderedImage;
+    if (heatMapRenderer.takeImage(renderedImage)) {
+        heatMap.setImage(renderedImage);
+    }
+    auto style = getHeatMapStyle();
+    if ((numReadyColumns != numRenderedColumns || style != renderedStyle) && heatMapRenderer.request(style)) {
+        numRenderedColumns = numReadyColumns;
+        renderedStyle = style;
+    }
+    if (numReadyColumns != numDrawnColumns) {
+        numDrawnColumns = numReadyColumns;
         drawEnvelopeView();
         drawSpectrumView();
         repaint();
@@ -592,10 +656,15 @@ void AnalyserWindow2::timerCallback() {
         entryButtons[i].setEnabled(canOperate);
     }
     recordButton.setEnabled(canOperate);
+    recordButton.setButtonText(recorder.isArmed() ? "Armed" : "Record");
     playButton.setEnabled(canOperate);
+    clearButton.setEnabled(canOperate);
 
     relocateFilterComponents();
     relocatePlayGuideComponents();
+    updateFilterInfo();
+    updateMemoryInfo();
+    updateSpectrogramInfo(length, spec);
 }
 void AnalyserWindow2::relocateFilterComponents() {
     int currentEntryIndex = recorder.getCurrentEntryIndex();
@@ -620,14 +689,14 @@ void AnalyserWindow2::relocatePlayGuideComponents() {
     int currentEntryIndex = recorder.getCurrentEntryIndex();
     {
         float playStartSec = allParams.entryParams[currentEntryIndex].PlayStartSec->get();
-        float x = heatMap.getX() + heatMap.getWidth() * (playStartSec / MAX_REC_SECONDS);
+        float x = heatMap.getX() + heatMap.getWidth() * (playStartSec / getTimeRangeInSec());
         playStartGrip.setBounds(
             x - (GRIP_WIDTH / 2), heatMap.getY() - GRIP_MARGIN - GRIP_LENGTH, GRIP_WIDTH, GRIP_LENGTH);
     }
     if (recorder.isPlaying()) {
         playingPosition.setVisible(true);
         float pos = recorder.getPlayingPositionInSec();
-        float x = heatMap.getX() + heatMap.getWidth() * (pos / MAX_REC_SECONDS);
+        float x = heatMap.getX() + heatMap.getWidth() * (pos / getTimeRangeInSec());
         playingPosition.setBounds(x, heatMap.getY(), 1, heatMap.getHeight());
     } else {
         playingPosition.setVisible(false);
@@ -637,13 +706,11 @@ void AnalyserWindow2::buttonClicked(juce::Button* button) {
     for (int i = 0; i < NUM_ENTRIES; i++) {
         if (button == &entryButtons[i]) {
             recorder.setCurrentEntryIndex(i);
-            calculated = false;
         }
     }
     if (button == &recordButton) {
         if (recorder.canOperate()) {
-            calculated = false;
-            recorder.record();
+            recorder.record(allParams.RecSeconds->get(), allParams.RecToDisk->get(), getTriggerSpec());
             recordButton.setToggleState(false, juce::dontSendNotification);
             recordButton.setEnabled(false);
         }
@@ -651,18 +718,25 @@ void AnalyserWindow2::buttonClicked(juce::Button* button) {
         if (recorder.canOperate()) {
             int entryIndex = recorder.getCurrentEntryIndex();
             auto& entryParams = allParams.entryParams[entryIndex];
-            recorder.play(entryParams.PlayStartSec->get(),
-                          true,
-                          //   allParams.FilterN->get(),
-                          400,
-                          entryParams.FilterLowFreq->get(),
-                          entryParams.FilterHighFreq->get());  // TODO
+            recorder.play(entryParams.PlayStartSec->get(), true, getFilterSpec());
             recordButton.setToggleState(false, juce::dontSendNotification);
             recordButton.setEnabled(false);
         }
     } else if (button == &stopButton) {
         recorder.stop();
         stopButton.setToggleState(false, juce::dontSendNotification);
+    } else if (button == &clearButton) {
+        if (recorder.canOperate()) {
+            recorder.clear();
+        }
+        clearButton.setToggleState(false, juce::dontSendNotification);
+    } else if (button == &diskButton) {
+        *allParams.RecToDisk = diskButton.getToggleState();
+    } else if (button == &iirButton) {
+        *allParams.FilterMode = iirButton.getToggleState() ? 1 : 0;
+    } else if (button == &autoOrderButton) {
+        *allParams.FilterAuto = autoOrderButton.getToggleState();
+        updateFilter();
     }
 }
 void AnalyserWindow2::mouseDown(const MouseEvent& event) {
@@ -670,7 +744,7 @@ void AnalyserWindow2::mouseDown(const MouseEvent& event) {
         auto bounds = heatMap.getBounds();
         auto xratio = (float)event.x / bounds.getWidth();
         auto yratio = (float)event.y / bounds.getHeight();
-        auto sec = MAX_REC_SECONDS * xratio;
+        auto sec = getTimeRangeInSec() * xratio;
         auto freq = xToHz(VIEW_MIN_FREQ, VIEW_MAX_FREQ, 1.0f - yratio);
         auto& entryParams = allParams.entryParams[recorder.getCurrentEntryIndex()];
         *entryParams.FocusSec = sec;
@@ -693,6 +767,7 @@ void AnalyserWindow2::mouseDrag(const MouseEvent& event) {
         }
         auto freq = xToHz(VIEW_MIN_FREQ, VIEW_MAX_FREQ, yratio);
         *allParams.entryParams[recorder.getCurrentEntryIndex()].FilterHighFreq = freq;
+        updateFilter();
     } else if (event.eventComponent == &lowFreqGrip) {
         auto bounds = heatMap.getBounds();
         float y = getMouseXYRelative().y;
@@ -704,6 +779,7 @@ void AnalyserWindow2::mouseDrag(const MouseEvent& event) {
         }
         auto freq = xToHz(VIEW_MIN_FREQ, VIEW_MAX_FREQ, yratio);
         *allParams.entryParams[recorder.getCurrentEntryIndex()].FilterLowFreq = freq;
+        updateFilter();
     } else if (event.eventComponent == &playStartGrip) {
         auto bounds = heatMap.getBounds();
         float x = getMouseXYRelative().x;
@@ -713,10 +789,64 @@ void AnalyserWindow2::mouseDrag(const MouseEvent& event) {
         if (xratio < 0 || xratio > 1) {
             return;
         }
-        auto sec = MAX_REC_SECONDS * xratio;
+        auto sec = getTimeRangeInSec() * xratio;
         *allParams.entryParams[recorder.getCurrentEntryIndex()].PlayStartSec = sec;
     }
 }
+void AnalyserWindow2::updateFilter() {
+    // the playing entry is filtered at its own rate
+    auto sampleRate = recorder.getSnapshot(recorder.getCurrentEntryIndex())->sampleRate;
+    recorder.setCrossfadeLength((int)(allParams.FilterCrossfadeMs->get() * 0.001f * sampleRate));
+    recorder.updateFilter(getFilterSpec());
+}
+FilterSpec AnalyserWindow2::getFilterSpec() {
+    auto entryIndex = recorder.getCurrentEntryIndex();
+    auto& entryParams = allParams.entryParams[entryIndex];
+    FilterSpec spec;
+    spec.entryIndex = entryIndex;
+    spec.type = allParams.FilterMode->getIndex() == 1 ? FilterType::IIR : FilterType::FIR;
+    spec.lowFreq = entryParams.FilterLowFreq->get();
+    spec.highFreq = entryParams.FilterHighFreq->get();
+    spec.n = allParams.FilterAuto->get() ? 0 : allParams.FilterN->get();
+    spec.transitionRatio = allParams.FilterTransition->get();
+    spec.attenuation = allParams.FilterAttenuation->get();
+    return spec;
+}
+TriggerSpec AnalyserWindow2::getTriggerSpec() {
+    TriggerSpec spec;
+    spec.mode = static_cast<TriggerMode>(allParams.RecTrigger->getIndex());
+    spec.threshold = juce::Decibels::decibelsToGain(allParams.TriggerLevel->get(), -120.0f);
+    spec.preRollSeconds = allParams.PreRollSec->get();
+    return spec;
+}
+void AnalyserWindow2::updateFilterInfo() {
+    auto spec = getFilterSpec();
+    // played with FIR instead (see Recorder::play())
+    auto isIirUnavailable = spec.type == FilterType::IIR && !recorder.canRenderIir(spec.entryIndex);
+    if (isIirUnavailable) {
+        spec.type = FilterType::FIR;
+    }
+    if (spec.type == FilterType::IIR) {
+        auto iir = recorder.resolveIirFilter(spec);
+        auto cost = BiquadCascade(iir).estimateCost();
+        filterInfoLabel.setText("Order " + juce::String(iir.order) + " (zero-phase), " + juce::String(cost, 0) +
+                                    " ops/sample",
+                                juce::dontSendNotification);
+        return;
+    }
+    auto kernel = recorder.resolveFilter(spec);
+    auto size = kernel.n + 1;
+    // stereo
+    auto opsPerSec = 2.0 * ConvolutionKernel::estimateCost(size, CONVOLUTION_BLOCK_SIZE) * kernel.sampleRate;
+    auto text = "N " + juce::String(kernel.n) +
+                (ConvolutionKernel::prefersFFT(size, CONVOLUTION_BLOCK_SIZE) ? " (FFT), " : " (direct), ") +
+                juce::String(opsPerSec / 1000000.0, 1) + " Mops/s";
+    if (isIirUnavailable) {
+        text = "No IIR for disk takes or over " + juce::String(MAX_IIR_RENDER_SAMPLES / kernel.sampleRate, 0) +
+               " s, FIR " + text;
+    }
+    filterInfoLabel.setText(text, juce::dontSendNotification);
+}
 void AnalyserWindow2::mouseDoubleClick(const MouseEvent& event) {
     if (event.eventComponent == &spectrumView) {
         auto bounds = heatMap.getBounds();
@@ -730,45 +860,63 @@ void AnalyserWindow2::mouseDoubleClick(const MouseEvent& event) {
         repaint();
     }
 }
-void AnalyserWindow2::calculateSpectrum(int timeScopeIndex) {
-    int currentEntryIndex = recorder.getCurrentEntryIndex();
-    auto& entry = recorder.entries[currentEntryIndex];
-    int sampleIndex = ((float)timeScopeIndex / (float)TIME_SCOPE_SIZE) * MAX_REC_SAMPLES;
-    jassert(sampleIndex >= 0);
-    jassert(sampleIndex < MAX_REC_SAMPLES);
-    auto& fftData = allFftData[timeScopeIndex];
-    for (int i = 0; i < FFT_SIZE; i++) {
-        auto dataIndex = sampleIndex - FFT_SIZE + i;
-        fftData[i] = dataIndex >= 0 ? (entry.dataL[dataIndex] + entry.dataR[dataIndex]) * 0.5f : 0;
-        fftData[i + FFT_SIZE] = 0;
-    }
-    window.multiplyWithWindowingTable(fftData, FFT_SIZE);
-    forwardFFT.performFrequencyOnlyForwardTransform(fftData);
-
-    auto sampleRate = entry.sampleRate;
-    auto mindB = -100.0f;
-    auto maxdB = 0.0f;
-    auto& scopeData = allScopeData[timeScopeIndex];
-    for (int i = 0; i < FREQ_SCOPE_SIZE; ++i) {
-        float hz = xToHz(VIEW_MIN_FREQ, VIEW_MAX_FREQ, (float)i / FREQ_SCOPE_SIZE);
-        float gain = getFFTDataByHz(fftData, FFT_SIZE, sampleRate, hz);
-        auto level = juce::jmap(juce::Decibels::gainToDecibels(gain) - juce::Decibels::gainToDecibels((float)FFT_SIZE),
-                                mindB,
-                                maxdB,
-                                0.0f,
-                                1.0f);
-        scopeData[i] = level;
-    }
-}
-void AnalyserWindow2::drawHeatMap() {
-    Graphics g(heatMap.getImage());
-    for (int t = 0; t < TIME_SCOPE_SIZE; ++t) {
-        auto& scopeData = allScopeData[t];
-        for (int i = 0; i < FREQ_SCOPE_SIZE; ++i) {
-            g.setColour(Colour::greyLevel(scopeData[i]));
-            g.drawRect(t, FREQ_SCOPE_SIZE - i, 1, 1);
-        }
+void AnalyserWindow2::updateMemoryInfo() {
+    auto toMB = [](size_t bytes) { return juce::String(bytes / (1024.0 * 1024.0), 1); };
+    auto text = toMB(recorder.getAllocatedBytes()) + " MB (" + toMB(ChunkPool::getTotalAllocatedBytes()) + " / " +
+                toMB(ChunkPool::getMemoryBudget()) + " MB)";
+    // the take is incomplete: the disk could not keep up with the input
+    auto numDropped = recorder.getNumDroppedSamples(recorder.getCurrentEntryIndex());
+    if (numDropped > 0) {
+        text += ", " + juce::String(numDropped) + " samples lost";
+    }
+    // the take stopped where the memory budget (or the pool) ran out
+    if (recorder.isCutShort(recorder.getCurrentEntryIndex())) {
+        text += ", cut short";
+    }
+    memoryLabel.setText(text, juce::dontSendNotification);
+}
+void AnalyserWindow2::updateSpectrogramInfo(int length, const SpectrogramSpec& spec) {
+    if (length <= 0) {
+        spectrogramInfoLabel.setText("", juce::dontSendNotification);
+        return;
+    }
+    auto hop = (float)length / spec.numColumns;
+    auto text = "Hop " + juce::String(hop, 0) + " samples, FFT " + juce::String(1 << spec.fftOrder);
+    // a fixed hop is only honoured from one up to MAX_SPECTROGRAM_COLUMNS columns
+    auto hopIndex = allParams.SpectrogramHop->getIndex();
+    if (hopIndex > 0 && spec.numColumns != length / (64 << hopIndex)) {
+        text += " (hop limited by the length)";
+    }
+    spectrogramInfoLabel.setText(text, juce::dontSendNotification);
+}
+SpectrogramSpec AnalyserWindow2::getSpectrogramSpec(int length, int width) {
+    using Window = juce::dsp::WindowingFunction<float>;
+    const Window::WindowingMethod windows[] = {
+        Window::hann, Window::hamming, Window::blackmanHarris, Window::rectangular};
+    SpectrogramSpec spec;
+    spec.numBins = FREQ_SCOPE_SIZE;
+    spec.fftOrder = SpectrogramCalculator::minFftOrder + allParams.SpectrogramFftSize->getIndex();
+    spec.window = windows[allParams.SpectrogramWindow->getIndex()];
+    spec.multiResolution = allParams.SpectrogramMultiResolution->get();
+    spec.channel = static_cast<StereoChannel>(allParams.HeatMapChannel->getIndex());
+    spec.minFreq = VIEW_MIN_FREQ;
+    spec.maxFreq = VIEW_MAX_FREQ;
+    auto hopIndex = allParams.SpectrogramHop->getIndex();
+    if (hopIndex == 0) {
+        // as many columns as can be seen
+        spec.numColumns = juce::jlimit((int)MIN_AUTO_SPECTROGRAM_COLUMNS, MAX_SPECTROGRAM_COLUMNS, width);
+    } else {
+        auto hop = 64 << hopIndex;
+        spec.numColumns = juce::jlimit(1, MAX_SPECTROGRAM_COLUMNS, length / hop);
     }
+    return spec;
+}
+HeatMapStyle AnalyserWindow2::getHeatMapStyle() {
+    HeatMapStyle style;
+    style.colourMap = static_cast<ColourMap>(allParams.HeatMapColours->getIndex());
+    style.floordB = allParams.HeatMapFloor->get();
+    style.ceilingdB = allParams.HeatMapCeiling->get();
+    return style;
 }
 void AnalyserWindow2::drawEnvelopeView() {
     auto& image = envelopeView.getImage();
@@ -780,18 +928,17 @@ void AnalyserWindow2::drawEnvelopeView() {
     g.fillRect(bounds);
 
     g.setColour(colour::GUIDE_LINE);
-    int currentEntryIndex = recorder.getCurrentEntryIndex();
-    auto& entry = recorder.entries[currentEntryIndex];
-    for (int i = 1; i < MAX_REC_SECONDS; i++) {
-        float x = width * ((float)i / MAX_REC_SECONDS);
+    auto timeRange = getTimeRangeInSec();
+    for (int i = 1; i < timeRange; i++) {
+        float x = width * ((float)i / timeRange);
         g.drawLine({x, 0, x, bottom});
     }
 
     g.setColour(colour::ENVELOPE_LINE);
     int y = getFocusedFreqIndex();
     for (int x = 1; x < TIME_SCOPE_SIZE; ++x) {
-        auto prev = allScopeData[x - 1][y];
-        auto curr = allScopeData[x][y];
+        auto prev = getLevel(x - 1, y);
+        auto curr = getLevel(x, y);
         g.drawLine({(float)x - 1, (1 - prev) * ENVELOPE_VIEW_HEIGHT, (float)x, (1 - curr) * ENVELOPE_VIEW_HEIGHT});
     }
 }
@@ -815,8 +962,8 @@ void AnalyserWindow2::drawSpectrumView() {
     g.setColour(colour::SPECTRUM_LINE);
     int x = getFocusedTimeIndex();
     for (int y = 1; y < FREQ_SCOPE_SIZE; ++y) {
-        auto prev = allScopeData[x][y - 1];
-        auto curr = allScopeData[x][y];
+        auto prev = getLevel(x, y - 1);
+        auto curr = getLevel(x, y);
         g.drawLine({prev * SPECTRUM_VIEW_WIDTH,
                     ((float)FREQ_SCOPE_SIZE - 1) - ((float)y - 1),
                     curr * SPECTRUM_VIEW_WIDTH,
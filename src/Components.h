@@ -2,8 +2,11 @@
 
 #include <JuceHeader.h>
 
+#include "HeatMap.h"
+#include "LogFrequencyMap.h"
 #include "LookAndFeel.h"
 #include "PluginProcessor.h"
+#include "Spectrogram.h"
 #include "StyleConstants.h"
 
 using namespace styles;
@@ -418,7 +421,7 @@ private:
 
     float levelDataL[2048];
     float levelDataR[2048];
-    LatestDataProvider::Consumer levelConsumer{levelDataL, levelDataR, 2048, false};
+    LatestDataProvider::Consumer levelConsumer{levelDataL, levelDataR, 2048};
     float overflowedLevel = 0;
     int overflowWarning = 0;
 };
@@ -489,19 +492,25 @@ private:
     ANALYSER_MODE lastAnalyserMode = ANALYSER_MODE::Spectrum;
 
     // FFT
-    juce::dsp::FFT forwardFFT;
+    std::unique_ptr<StereoFft> forwardFFT;
     juce::dsp::WindowingFunction<float> window;
     static const int fftOrder = 11;
     static const int fftSize = 2048;
+    // L, then R
     float fftData[fftSize * 2];
-    LatestDataProvider::Consumer fftConsumer{fftData, fftData + fftSize, fftSize, false};
-    float scopeData[scopeSize]{};
+    LatestDataProvider::Consumer fftConsumer{fftData, fftData + fftSize, fftSize};
+    float magnitudes[StereoFft::numChannels][fftSize / 2 + 1];
+    float* magnitudePointers[StereoFft::numChannels];
+    float midScopeData[scopeSize]{};
+    float sideScopeData[scopeSize]{};
+    LogFrequencyMap frequencyMap;
+    float mappedSampleRate = 0;
     bool readyToDrawFrame = false;
 
     // Level
     float levelDataL[2048];
     float levelDataR[2048];
-    LatestDataProvider::Consumer levelConsumer{levelDataL, levelDataR, 2048, false};
+    LatestDataProvider::Consumer levelConsumer{levelDataL, levelDataR, 2048};
     float currentLevel[2]{};
     float overflowedLevelL = 0;
     float overflowedLevelR = 0;
@@ -515,15 +524,6 @@ private:
     void paintSpectrum(
         juce::Graphics& g, juce::Colour colour, int offsetX, int offsetY, int width, int height, float* scopeData);
     void paintLevel(juce::Graphics& g, int offsetX, int offsetY, int width, int height, float level);
-    static float xToHz(float minFreq, float maxFreq, float notmalizedX) {
-        return minFreq * std::pow(maxFreq / minFreq, notmalizedX);
-    }
-    static float getFFTDataByHz(float* processedFFTData, float fftSize, float sampleRate, float hz) {
-        float indexFloat = hz * ((fftSize * 0.5) / (sampleRate * 0.5));
-        int index = indexFloat;
-        float frac = indexFloat - index;
-        return processedFFTData[index] * (1 - frac) + processedFFTData[index + 1] * frac;
-    }
 };
 
 //==============================================================================
@@ -532,8 +532,10 @@ constexpr int FREQ_SCOPE_SIZE = 512;
 constexpr int TIME_SCOPE_SIZE = 1024;
 constexpr int ENVELOPE_VIEW_HEIGHT = 200;
 constexpr int SPECTRUM_VIEW_WIDTH = 200;
-constexpr int FFT_ORDER = 12;
-constexpr int FFT_SIZE = 4096;
+// with a fixed hop
+constexpr int MAX_SPECTROGRAM_COLUMNS = 8192;
+// the automatic hop gives a column per pixel of the heat map, but no fewer than this
+constexpr int MIN_AUTO_SPECTROGRAM_COLUMNS = 256;
 
 constexpr float VIEW_MIN_FREQ = 20.0f;
 constexpr float VIEW_MAX_FREQ = 20000.0f;
@@ -557,14 +559,39 @@ private:
     Recorder& recorder;
     AllParams& allParams;
 
-    juce::dsp::FFT forwardFFT;
-    juce::dsp::WindowingFunction<float> window;
-    float allFftData[TIME_SCOPE_SIZE][FFT_SIZE * 2]{};
-    float allScopeData[TIME_SCOPE_SIZE][FREQ_SCOPE_SIZE]{};
-    bool calculated = false;
+    SpectrogramCalculator spectrogram;
+    // what the views show, and the generation they were calculated from
+    std::shared_ptr<const EntrySnapshot> snapshot;
+    // the take being recorded into the entry, if isLive
+    bool isLive = false;
+    Recorder::LiveTake liveTake;
+    uint64_t calculatedGeneration = 0;
+    // the last finished spectrogram of each entry
+    std::array<CachedSpectrogram, NUM_ENTRIES> cachedSpectrograms{};
+    // columns drawn in the views since the calculation started
+    int numDrawnColumns = 0;
+    HeatMapRenderer heatMapRenderer{spectrogram};
+    // what the last heat map requested was drawn from
+    int numRenderedColumns = -1;
+    HeatMapStyle renderedStyle;
+    // 0 until the column is calculated
+    float getLevel(int timeScopeIndex, int freqScopeIndex) {
+        auto column = timeScopeIndex * spectrogram.getSpec().numColumns / TIME_SCOPE_SIZE;
+        if (!spectrogram.isReady(column)) {
+            return 0.0f;
+        }
+        return spectrogram.getLevel(column, freqScopeIndex);
+    }
     int getFocusedTimeIndex() {
         auto& entryParams = allParams.entryParams[recorder.getCurrentEntryIndex()];
-        return TIME_SCOPE_SIZE * (entryParams.FocusSec->get() / MAX_REC_SECONDS);
+        return TIME_SCOPE_SIZE * (entryParams.FocusSec->get() / getTimeRangeInSec());
+    }
+    // the whole entry, the take being recorded, or the recording length while it is empty
+    float getTimeRangeInSec() {
+        if (isLive) {
+            return liveTake.length / liveTake.sampleRate;
+        }
+        return snapshot->getNumSamples() > 0 ? snapshot->getLengthInSec() : allParams.RecSeconds->get();
     }
     int getFocusedFreqIndex() {
         auto& entryParams = allParams.entryParams[recorder.getCurrentEntryIndex()];
@@ -575,6 +602,13 @@ private:
     juce::ToggleButton recordButton;
     juce::ToggleButton playButton;
     juce::ToggleButton stopButton;
+    juce::ToggleButton clearButton;
+    juce::ToggleButton diskButton;
+    juce::ToggleButton iirButton;
+    juce::ToggleButton autoOrderButton;
+    juce::Label filterInfoLabel;
+    juce::Label memoryLabel;
+    juce::Label spectrogramInfoLabel;
     juce::ImageComponent heatMap;
     JustRectangle envelopeLine;
     JustRectangle spectrumLine;
@@ -594,8 +628,9 @@ private:
     virtual void mouseDrag(const MouseEvent& event) override;
     virtual void mouseDoubleClick(const MouseEvent& event) override;
 
-    void calculateSpectrum(int timeScopeIndex);
-    void drawHeatMap();
+    // for a take of `length` samples on a heat map `width` pixels wide
+    SpectrogramSpec getSpectrogramSpec(int length, int width);
+    HeatMapStyle getHeatMapStyle();
     void drawEnvelopeView();
     void drawSpectrumView();
     static float xToHz(float minFreq, float maxFreq, float normalizedX) {
@@ -616,14 +651,14 @@ private:
         auto B = (maxFreq - minFreq) / (std::pow(A, 2) - 1);
         return (std::logf((freq + B - minFreq) / B) / std::logf(-A)) / 2;
     }
-    static float getFFTDataByHz(float* processedFFTData, float fftSize, float sampleRate, float hz) {
-        float indexFloat = hz * ((fftSize * 0.5) / (sampleRate * 0.5));
-        int index = indexFloat;
-        float frac = indexFloat - index;
-        return processedFFTData[index] * (1 - frac) + processedFFTData[index + 1] * frac;
-    }
     void relocatePlayGuideComponents();
     void relocateFilterComponents();
+    void updateFilter();
+    FilterSpec getFilterSpec();
+    TriggerSpec getTriggerSpec();
+    void updateFilterInfo();
+    void updateMemoryInfo();
+    void updateSpectrogramInfo(int length, const SpectrogramSpec& spec);
     virtual bool keyPressed(const KeyPress& key, Component* originatingComponent) override;
     virtual bool keyStateChanged(bool isKeyDown, Component* originatingComponent) override;
 };
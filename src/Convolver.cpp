@@ -0,0 +1,131 @@
+#include "Convolver.h"
+
+namespace {
+int fftOrderOf(int blockSize) {
+    jassert(juce::isPowerOfTwo(blockSize));
+    int order = 0;
+    while ((1 << order) < blockSize * 2) {
+        order++;
+    }
+    return order;
+}
+double fftCostPerSample(int kernelSize, int blockSize) {
+    double fftSize = blockSize * 2.0;
+    double numPartitions = (kernelSize + blockSize - 1) / blockSize;
+    double transformCost = 2.0 * 2.5 * fftSize * std::log2(fftSize);
+    double spectralCost = 4.0 * (blockSize + 1) * numPartitions;
+    return (transformCost + spectralCost) / blockSize;
+}
+}  // namespace
+
+//==============================================================================
+ConvolutionKernel::ConvolutionKernel(const float *taps, int size, int blockSize)
+    : blockSize(blockSize),
+      numPartitions((size + blockSize - 1) / blockSize),
+      fft(prefersFFT(size, blockSize)),
+      taps(taps, taps + size) {
+    if (!fft) {
+        return;
+    }
+    juce::dsp::FFT transform(fftOrderOf(blockSize));
+    std::vector<float> buffer(blockSize * 4);
+    spectra.resize(numPartitions * getSpectrumSize());
+    for (int p = 0; p < numPartitions; p++) {
+        std::fill(buffer.begin(), buffer.end(), 0.0f);
+        auto offset = p * blockSize;
+        std::copy(taps + offset, taps + std::min(size, offset + blockSize), buffer.begin());
+        transform.performRealOnlyForwardTransform(buffer.data(), true);
+        std::copy(buffer.begin(), buffer.begin() + getSpectrumSize(), spectra.begin() + p * getSpectrumSize());
+    }
+}
+bool ConvolutionKernel::prefersFFT(int kernelSize, int blockSize) {
+    return fftCostPerSample(kernelSize, blockSize) < kernelSize;
+}
+double ConvolutionKernel::estimateCost(int kernelSize, int blockSize) {
+    return std::min(fftCostPerSample(kernelSize, blockSize), (double)kernelSize);
+}
+
+//==============================================================================
+Convolver::Convolver(int blockSize, int maxKernelSize)
+    : blockSize(blockSize),
+      maxPartitions(std::max(1, (maxKernelSize + blockSize - 1) / blockSize)),
+      fft(fftOrderOf(blockSize)),
+      history((maxPartitions + 1) * blockSize),
+      fdl(maxPartitions * 2 * (blockSize + 1)),
+      fdlCalculated(maxPartitions, false),
+      fftBuffer(blockSize * 4),
+      accumulator(2 * (blockSize + 1)) {}
+void Convolver::reset() {
+    std::fill(history.begin(), history.end(), 0.0f);
+    std::fill(fdlCalculated.begin(), fdlCalculated.end(), false);
+    fdlHead = 0;
+}
+void Convolver::pushBlock(const float *input) {
+    std::memmove(history.data(), history.data() + blockSize, sizeof(float) * maxPartitions * blockSize);
+    std::memcpy(getHistoryBlock(0), input, sizeof(float) * blockSize);
+    fdlHead = (fdlHead + 1) % maxPartitions;
+    fdlCalculated[fdlHead] = false;
+}
+void Convolver::convolve(const ConvolutionKernel &kernel, float *output) {
+    jassert(kernel.getBlockSize() == blockSize);
+    jassert(kernel.getNumPartitions() <= maxPartitions);
+    if (kernel.usesFFT()) {
+        processFFT(kernel, output);
+    } else {
+        processDirect(kernel, output);
+    }
+}
+void Convolver::processBlock(const ConvolutionKernel &kernel, const float *input, float *output) {
+    pushBlock(input);
+    convolve(kernel, output);
+}
+const float *Convolver::getSpectrum(int blocksAgo) {
+    auto slot = getSlot(blocksAgo);
+    auto *spectrum = fdl.data() + slot * 2 * (blockSize + 1);
+    if (!fdlCalculated[slot]) {
+        std::fill(fftBuffer.begin(), fftBuffer.end(), 0.0f);
+        std::memcpy(fftBuffer.data(), getHistoryBlock(blocksAgo + 1), sizeof(float) * 2 * blockSize);
+        fft.performRealOnlyForwardTransform(fftBuffer.data(), true);
+        std::memcpy(spectrum, fftBuffer.data(), sizeof(float) * 2 * (blockSize + 1));
+        fdlCalculated[slot] = true;
+    }
+    return spectrum;
+}
+void Convolver::processFFT(const ConvolutionKernel &kernel, float *output) {
+    auto numPartitions = kernel.getNumPartitions();
+    auto spectrumSize = kernel.getSpectrumSize();
+    std::fill(accumulator.begin(), accumulator.end(), 0.0f);
+    auto *acc = accumulator.data();
+    for (int j = 0; j < numPartitions; j++) {
+        auto *x = getSpectrum(j);
+        auto *h = kernel.getPartition(j);
+        for (int k = 0; k < spectrumSize; k += 2) {
+            acc[k] += x[k] * h[k] - x[k + 1] * h[k + 1];
+            acc[k + 1] += x[k] * h[k + 1] + x[k + 1] * h[k];
+        }
+    }
+    std::memcpy(fftBuffer.data(), acc, sizeof(float) * spectrumSize);
+    fft.performRealOnlyInverseTransform(fftBuffer.data());
+    // overlap-save: only the latter half is free from circular aliasing
+    std::memcpy(output, fftBuffer.data() + blockSize, sizeof(float) * blockSize);
+}
+void Convolver::processDirect(const ConvolutionKernel &kernel, float *output) {
+    auto *taps = kernel.getTaps();
+    auto *current = getHistoryBlock(0);
+    juce::FloatVectorOperations::clear(output, blockSize);
+    for (int n = 0; n < kernel.getSize(); n++) {
+        juce::FloatVectorOperations::addWithMultiply(output, current - n, taps[n], blockSize);
+    }
+}
+void Convolver::process(const ConvolutionKernel &kernel, const float *input, float *output, int numSamples) {
+    auto blockSize = kernel.getBlockSize();
+    Convolver convolver(blockSize, kernel.getSize());
+    std::vector<float> block(blockSize);
+    for (int i = 0; i < numSamples; i += blockSize) {
+        auto size = std::min(blockSize, numSamples - i);
+        std::fill(block.begin(), block.end(), 0.0f);
+        std::copy(input + i, input + i + size, block.begin());
+        convolver.processBlock(kernel, block.data(), block.data());
+        std::copy(block.begin(), block.begin() + size, output + i);
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+// Immutable FIR kernel prepared for Convolver.
+// Short kernels are kept in the time domain. Long ones are split into `blockSize`-long partitions whose spectra are
+// precomputed once, so the kernel can be shared between convolvers and swapped without recomputation.
+class ConvolutionKernel {
+public:
+    ConvolutionKernel(const float *taps, int size, int blockSize);
+    ~ConvolutionKernel(){};
+    ConvolutionKernel(const ConvolutionKernel &) = delete;
+
+    int getSize() const { return (int)taps.size(); }
+    int getBlockSize() const { return blockSize; }
+    int getNumPartitions() const { return numPartitions; }
+    bool usesFFT() const { return fft; }
+    const float *getTaps() const { return taps.data(); }
+    // interleaved complex, (blockSize + 1) bins
+    const float *getPartition(int index) const { return spectra.data() + index * getSpectrumSize(); }
+    int getSpectrumSize() const { return 2 * (blockSize + 1); }
+
+    // rough cost model: FFT transforms + complex multiply-adds per sample vs direct multiply-adds per sample
+    static bool prefersFFT(int kernelSize, int blockSize);
+    // operations per sample (per channel) of the cheaper path
+    static double estimateCost(int kernelSize, int blockSize);
+
+private:
+    int blockSize;
+    int numPartitions;
+    bool fft;
+    std::vector<float> taps;
+    std::vector<float> spectra;
+};
+
+//==============================================================================
+// Uniformly partitioned overlap-save convolution, with a direct-form (vectorised) path for short kernels.
+// Processes exactly one block of `blockSize` samples per call with zero latency. The input history (and its spectra)
+// does not depend on the kernel, so the same block may be convolved with several kernels (e.g. while crossfading).
+class Convolver {
+public:
+    Convolver(int blockSize, int maxKernelSize);
+    ~Convolver(){};
+    Convolver(const Convolver &) = delete;
+
+    int getBlockSize() const { return blockSize; }
+    int getMaxKernelSize() const { return maxPartitions * blockSize; }
+    void reset();
+    // pushes one block of input without producing output (e.g. to seed the history before playback)
+    void pushBlock(const float *input);
+    // output for the latest pushed block
+    void convolve(const ConvolutionKernel &kernel, float *output);
+    // pushBlock() + convolve(); `output` may be the same as `input`
+    void processBlock(const ConvolutionKernel &kernel, const float *input, float *output);
+    // convolves a whole buffer, assuming silence before `input`
+    static void process(const ConvolutionKernel &kernel, const float *input, float *output, int numSamples);
+
+private:
+    int blockSize;
+    int maxPartitions;
+    juce::dsp::FFT fft;
+    // (maxPartitions + 1) blocks, the newest block is at the end
+    std::vector<float> history;
+    // frequency-domain delay line: spectra of the latest blocks (ring buffer of maxPartitions), calculated lazily
+    std::vector<float> fdl;
+    std::vector<bool> fdlCalculated;
+    int fdlHead = 0;
+    std::vector<float> fftBuffer;
+    std::vector<float> accumulator;
+
+    float *getHistoryBlock(int blocksAgo) { return history.data() + (maxPartitions - blocksAgo) * blockSize; }
+    int getSlot(int blocksAgo) const { return (fdlHead - blocksAgo + maxPartitions) % maxPartitions; }
+    const float *getSpectrum(int blocksAgo);
+    void processFFT(const ConvolutionKernel &kernel, float *output);
+    void processDirect(const ConvolutionKernel &kernel, float *output);
+};
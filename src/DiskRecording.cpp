@@ -0,0 +1,174 @@
+#include "DiskRecording.h"
+
+namespace {
+// seconds of audio the FIFO can hold while the writer thread is behind
+constexpr double FIFO_SECONDS = 2.0;
+constexpr int WRITER_INTERVAL_MS = 20;
+}  // namespace
+
+//==============================================================================
+DiskRecording::DiskRecording() : juce::Thread("Disk Recording Writer") {}
+DiskRecording::~DiskRecording() { clear(); }
+
+bool DiskRecording::start(double sampleRate, int maxSamples) {
+    clear();
+    file = juce::File::getSpecialLocation(juce::File::tempDirectory).getNonexistentChildFile("SeedRecording", ".wav");
+    std::unique_ptr<juce::FileOutputStream> stream(file.createOutputStream());
+    if (stream == nullptr) {
+        return false;
+    }
+    juce::WavAudioFormat format;
+    // 32 bit: written and mapped as float without conversion
+    writer.reset(format.createWriterFor(stream.get(), sampleRate, 2, 32, {}, 0));
+    if (writer == nullptr) {
+        return false;
+    }
+    stream.release();
+
+    auto fifoSize = (int)(sampleRate * FIFO_SECONDS);
+    fifo.setTotalSize(fifoSize);
+    fifo.reset();
+    fifoL.assign(fifoSize, 0.0f);
+    fifoR.assign(fifoSize, 0.0f);
+    capacity = maxSamples;
+    Gap gap;
+    while (gaps.pop(gap)) {
+    }
+    numAppended = 0;
+    numQueued = 0;
+    gapLength = 0;
+    numDropped = 0;
+    numDrained = 0;
+    nextGap = Gap{};
+    startThread();
+    return true;
+}
+int DiskRecording::append(const float *sourceL, const float *sourceR, int size) {
+    size = std::min(size, capacity - numAppended);
+    // the writer has to know about a gap before it reads the samples that follow it
+    if (gapLength > 0 && gaps.push(Gap{numQueued, gapLength})) {
+        gapLength = 0;
+    }
+    int written = 0;
+    if (gapLength == 0) {
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite(size, start1, size1, start2, size2);
+        juce::FloatVectorOperations::copy(fifoL.data() + start1, sourceL, size1);
+        juce::FloatVectorOperations::copy(fifoR.data() + start1, sourceR, size1);
+        juce::FloatVectorOperations::copy(fifoL.data() + start2, sourceL + size1, size2);
+        juce::FloatVectorOperations::copy(fifoR.data() + start2, sourceR + size1, size2);
+        fifo.finishedWrite(size1 + size2);
+        written = size1 + size2;
+        numQueued += written;
+    }
+    gapLength += size - written;
+    numDropped += size - written;
+    numAppended += size;
+    return size;
+}
+void DiskRecording::finish() {
+    if (writer == nullptr) {
+        return;
+    }
+    stopThread(-1);
+    drain();
+    // dropped at the very end
+    writeSilence(gapLength);
+    gapLength = 0;
+    // the header is completed when the writer is deleted
+    writer.reset();
+    fifoL = {};
+    fifoR = {};
+
+    juce::WavAudioFormat format;
+    reader.reset(format.createMemoryMappedReader(file));
+    if (reader == nullptr || !reader->mapEntireFile()) {
+        reader.reset();
+        return;
+    }
+    numSamples.store((int)reader->lengthInSamples, std::memory_order_release);
+}
+void DiskRecording::clear() {
+    if (writer != nullptr) {
+        stopThread(-1);
+        writer.reset();
+    }
+    numSamples.store(0, std::memory_order_release);
+    reader.reset();
+    fifoL = {};
+    fifoR = {};
+    capacity = 0;
+    if (file != juce::File()) {
+        file.deleteFile();
+        file = juce::File();
+    }
+}
+void DiskRecording::run() {
+    while (!threadShouldExit()) {
+        drain();
+        wait(WRITER_INTERVAL_MS);
+    }
+}
+void DiskRecording::drain() {
+    while (true) {
+        auto numReady = fifo.getNumReady();
+        // popped after reading the FIFO, so that a gap before the ready samples cannot be missed
+        if (nextGap.length == 0) {
+            gaps.pop(nextGap);
+        }
+        if (nextGap.length > 0 && nextGap.position == numDrained) {
+            writeSilence(nextGap.length);
+            nextGap = Gap{};
+            continue;
+        }
+        if (nextGap.length > 0) {
+            numReady = std::min(numReady, nextGap.position - numDrained);
+        }
+        if (numReady <= 0) {
+            return;
+        }
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(numReady, start1, size1, start2, size2);
+        if (size1 > 0) {
+            const float *channels[] = {fifoL.data() + start1, fifoR.data() + start1};
+            writer->writeFromFloatArrays(channels, 2, size1);
+        }
+        if (size2 > 0) {
+            const float *channels[] = {fifoL.data() + start2, fifoR.data() + start2};
+            writer->writeFromFloatArrays(channels, 2, size2);
+        }
+        fifo.finishedRead(size1 + size2);
+        numDrained += size1 + size2;
+    }
+}
+void DiskRecording::writeSilence(int length) {
+    std::array<float, 1024> silence{};
+    const float *channels[] = {silence.data(), silence.data()};
+    for (int done = 0; done < length; done += (int)silence.size()) {
+        writer->writeFromFloatArrays(channels, 2, std::min(length - done, (int)silence.size()));
+    }
+}
+
+void DiskRecording::read(int start, float *destinationL, float *destinationR, int size) const {
+    // the reader fills the outside of the file with silence
+    juce::FloatVectorOperations::clear(destinationL, size);
+    juce::FloatVectorOperations::clear(destinationR, size);
+    auto end = getNumSamples();
+    auto from = juce::jlimit(0, end, start);
+    auto to = juce::jlimit(0, end, start + size);
+    if (reader == nullptr || to <= from) {
+        return;
+    }
+    float *channels[] = {destinationL + (from - start), destinationR + (from - start)};
+    juce::AudioBuffer<float> buffer(channels, 2, to - from);
+    reader->read(&buffer, 0, to - from, from, true, true);
+}
+void DiskRecording::addTo(int start, float *outputL, float *outputR, int size) const {
+    for (int done = 0; done < size;) {
+        auto length = std::min(size - done, (int)scratchL.size());
+        read(start + done, scratchL.data(), scratchR.data(), length);
+        juce::FloatVectorOperations::add(outputL + done, scratchL.data(), length);
+        juce::FloatVectorOperations::add(outputR + done, scratchR.data(), length);
+        done += length;
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "LockFreeQueue.h"
+#include "RecordingSource.h"
+
+//==============================================================================
+// Stereo take streamed to a temporary WAV file, for recordings too long to keep on the heap.
+// The audio thread only pushes into a lock-free FIFO; a writer thread drains it into the file. Once finished, the
+// file is memory-mapped and read through juce::MemoryMappedAudioFormatReader. Samples that do not fit in the FIFO
+// (when the disk cannot keep up) are replaced with silence, so the rest of the take stays in time.
+class DiskRecording : public RecordingSource, private juce::Thread {
+public:
+    DiskRecording();
+    ~DiskRecording() override;
+    DiskRecording(const DiskRecording &) = delete;
+
+    // non-audio thread, while not being written or read: starts a new take of up to `maxSamples`
+    bool start(double sampleRate, int maxSamples);
+    // audio thread: returns the number of samples taken, which is less than `size` when full.
+    // samples that do not fit in the FIFO are written as silence (and counted) instead of blocking.
+    int append(const float *sourceL, const float *sourceR, int size);
+    // non-audio thread, after the last append(): writes the rest, closes the file and maps it for reading
+    void finish();
+    // non-audio thread, while not being written or read: deletes the take
+    void clear();
+    bool isWriting() const { return writer != nullptr; }
+    // samples replaced with silence
+    int getNumDroppedSamples() const { return numDropped.load(); }
+
+    int getNumSamples() const override { return numSamples.load(std::memory_order_acquire); }
+    void read(int start, float *destinationL, float *destinationR, int size) const override;
+    void addTo(int start, float *outputL, float *outputR, int size) const override;
+
+private:
+    juce::File file;
+    std::unique_ptr<juce::AudioFormatWriter> writer;
+    std::unique_ptr<juce::MemoryMappedAudioFormatReader> reader;
+
+    juce::AbstractFifo fifo{1};
+    std::vector<float> fifoL;
+    std::vector<float> fifoR;
+    int capacity = 0;
+    // a run of dropped samples, before the FIFO sample at `position`
+    struct Gap {
+        int position = 0;
+        int length = 0;
+    };
+    LockFreeQueue<Gap, 64> gaps;
+    // audio thread
+    int numAppended = 0;
+    int numQueued = 0;
+    // dropped but not yet queued
+    int gapLength = 0;
+    std::atomic<int> numDropped{0};
+    // writer thread
+    int numDrained = 0;
+    Gap nextGap;
+    std::atomic<int> numSamples{0};
+    // audio thread (addTo)
+    mutable std::array<float, 512> scratchL{};
+    mutable std::array<float, 512> scratchR{};
+
+    void run() override;
+    void drain();
+    void writeSilence(int length);
+};
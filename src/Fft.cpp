@@ -0,0 +1,316 @@
+#include "Fft.h"
+
+#if JUCE_INTEL
+#include <immintrin.h>
+#if defined(__GNUC__)
+#define SEED_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define SEED_TARGET_AVX2
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define SEED_FFT_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace {
+//==============================================================================
+// One radix-2 stage: `half` twiddles with `stride` butterflies each. x[stride * p + q] and x[stride * (p + half) + q]
+// go to y[stride * 2p + q] and y[stride * (2p + 1) + q], the latter turned by w[stride * p].
+void radix2Stage(const float *xr, const float *xi, float *yr, float *yi, int stride, int half, const float *wr,
+                 const float *wi) {
+    for (int p = 0; p < half; p++) {
+        auto twr = wr[stride * p];
+        auto twi = wi[stride * p];
+        auto a = stride * p;
+        auto b = stride * (p + half);
+        auto y0 = stride * 2 * p;
+        auto y1 = y0 + stride;
+        for (int q = 0; q < stride; q++) {
+            auto dr = xr[a + q] - xr[b + q];
+            auto di = xi[a + q] - xi[b + q];
+            yr[y0 + q] = xr[a + q] + xr[b + q];
+            yi[y0 + q] = xi[a + q] + xi[b + q];
+            yr[y1 + q] = dr * twr - di * twi;
+            yi[y1 + q] = dr * twi + di * twr;
+        }
+    }
+}
+// One radix-4 stage, the same with x[stride * (p + m * quarter) + q] for m < 4 going to y[stride * (4p + m) + q],
+// turned by w[stride * p * m].
+void radix4Stage(const float *xr, const float *xi, float *yr, float *yi, int stride, int quarter, const float *wr,
+                 const float *wi) {
+    for (int p = 0; p < quarter; p++) {
+        float twr[4], twi[4];
+        for (int m = 1; m < 4; m++) {
+            twr[m] = wr[stride * p * m];
+            twi[m] = wi[stride * p * m];
+        }
+        const int x0 = stride * p, x1 = x0 + stride * quarter, x2 = x1 + stride * quarter, x3 = x2 + stride * quarter;
+        const int y0 = stride * 4 * p, y1 = y0 + stride, y2 = y1 + stride, y3 = y2 + stride;
+        for (int q = 0; q < stride; q++) {
+            auto b0r = xr[x0 + q] + xr[x2 + q], b0i = xi[x0 + q] + xi[x2 + q];
+            auto b1r = xr[x0 + q] - xr[x2 + q], b1i = xi[x0 + q] - xi[x2 + q];
+            auto b2r = xr[x1 + q] + xr[x3 + q], b2i = xi[x1 + q] + xi[x3 + q];
+            // -i (x1 - x3)
+            auto b3r = xi[x1 + q] - xi[x3 + q], b3i = xr[x3 + q] - xr[x1 + q];
+            yr[y0 + q] = b0r + b2r;
+            yi[y0 + q] = b0i + b2i;
+            auto cr = b1r + b3r, ci = b1i + b3i;
+            yr[y1 + q] = cr * twr[1] - ci * twi[1];
+            yi[y1 + q] = cr * twi[1] + ci * twr[1];
+            cr = b0r - b2r, ci = b0i - b2i;
+            yr[y2 + q] = cr * twr[2] - ci * twi[2];
+            yi[y2 + q] = cr * twi[2] + ci * twr[2];
+            cr = b1r - b3r, ci = b1i - b3i;
+            yr[y3 + q] = cr * twr[3] - ci * twi[3];
+            yi[y3 + q] = cr * twi[3] + ci * twr[3];
+        }
+    }
+}
+#if JUCE_INTEL
+void sseRadix4Stage(const float *xr, const float *xi, float *yr, float *yi, int stride, int quarter, const float *wr,
+                    const float *wi) {
+    for (int p = 0; p < quarter; p++) {
+        __m128 twr[4], twi[4];
+        for (int m = 1; m < 4; m++) {
+            twr[m] = _mm_set1_ps(wr[stride * p * m]);
+            twi[m] = _mm_set1_ps(wi[stride * p * m]);
+        }
+        const int x0 = stride * p, x1 = x0 + stride * quarter, x2 = x1 + stride * quarter, x3 = x2 + stride * quarter;
+        const int y0 = stride * 4 * p, y1 = y0 + stride, y2 = y1 + stride, y3 = y2 + stride;
+        for (int q = 0; q < stride; q += 4) {
+            auto a0r = _mm_loadu_ps(xr + x0 + q), a0i = _mm_loadu_ps(xi + x0 + q);
+            auto a1r = _mm_loadu_ps(xr + x1 + q), a1i = _mm_loadu_ps(xi + x1 + q);
+            auto a2r = _mm_loadu_ps(xr + x2 + q), a2i = _mm_loadu_ps(xi + x2 + q);
+            auto a3r = _mm_loadu_ps(xr + x3 + q), a3i = _mm_loadu_ps(xi + x3 + q);
+            auto b0r = _mm_add_ps(a0r, a2r), b0i = _mm_add_ps(a0i, a2i);
+            auto b1r = _mm_sub_ps(a0r, a2r), b1i = _mm_sub_ps(a0i, a2i);
+            auto b2r = _mm_add_ps(a1r, a3r), b2i = _mm_add_ps(a1i, a3i);
+            auto b3r = _mm_sub_ps(a1i, a3i), b3i = _mm_sub_ps(a3r, a1r);
+            _mm_storeu_ps(yr + y0 + q, _mm_add_ps(b0r, b2r));
+            _mm_storeu_ps(yi + y0 + q, _mm_add_ps(b0i, b2i));
+            auto cr = _mm_add_ps(b1r, b3r), ci = _mm_add_ps(b1i, b3i);
+            _mm_storeu_ps(yr + y1 + q, _mm_sub_ps(_mm_mul_ps(cr, twr[1]), _mm_mul_ps(ci, twi[1])));
+            _mm_storeu_ps(yi + y1 + q, _mm_add_ps(_mm_mul_ps(cr, twi[1]), _mm_mul_ps(ci, twr[1])));
+            cr = _mm_sub_ps(b0r, b2r), ci = _mm_sub_ps(b0i, b2i);
+            _mm_storeu_ps(yr + y2 + q, _mm_sub_ps(_mm_mul_ps(cr, twr[2]), _mm_mul_ps(ci, twi[2])));
+            _mm_storeu_ps(yi + y2 + q, _mm_add_ps(_mm_mul_ps(cr, twi[2]), _mm_mul_ps(ci, twr[2])));
+            cr = _mm_sub_ps(b1r, b3r), ci = _mm_sub_ps(b1i, b3i);
+            _mm_storeu_ps(yr + y3 + q, _mm_sub_ps(_mm_mul_ps(cr, twr[3]), _mm_mul_ps(ci, twi[3])));
+            _mm_storeu_ps(yi + y3 + q, _mm_add_ps(_mm_mul_ps(cr, twi[3]), _mm_mul_ps(ci, twr[3])));
+        }
+    }
+}
+SEED_TARGET_AVX2 void avx2Radix4Stage(const float *xr, const float *xi, float *yr, float *yi, int stride, int quarter,
+                                      const float *wr, const float *wi) {
+    for (int p = 0; p < quarter; p++) {
+        __m256 twr[4], twi[4];
+        for (int m = 1; m < 4; m++) {
+            twr[m] = _mm256_set1_ps(wr[stride * p * m]);
+            twi[m] = _mm256_set1_ps(wi[stride * p * m]);
+        }
+        const int x0 = stride * p, x1 = x0 + stride * quarter, x2 = x1 + stride * quarter, x3 = x2 + stride * quarter;
+        const int y0 = stride * 4 * p, y1 = y0 + stride, y2 = y1 + stride, y3 = y2 + stride;
+        for (int q = 0; q < stride; q += 8) {
+            auto a0r = _mm256_loadu_ps(xr + x0 + q), a0i = _mm256_loadu_ps(xi + x0 + q);
+            auto a1r = _mm256_loadu_ps(xr + x1 + q), a1i = _mm256_loadu_ps(xi + x1 + q);
+            auto a2r = _mm256_loadu_ps(xr + x2 + q), a2i = _mm256_loadu_ps(xi + x2 + q);
+            auto a3r = _mm256_loadu_ps(xr + x3 + q), a3i = _mm256_loadu_ps(xi + x3 + q);
+            auto b0r = _mm256_add_ps(a0r, a2r), b0i = _mm256_add_ps(a0i, a2i);
+            auto b1r = _mm256_sub_ps(a0r, a2r), b1i = _mm256_sub_ps(a0i, a2i);
+            auto b2r = _mm256_add_ps(a1r, a3r), b2i = _mm256_add_ps(a1i, a3i);
+            auto b3r = _mm256_sub_ps(a1i, a3i), b3i = _mm256_sub_ps(a3r, a1r);
+            _mm256_storeu_ps(yr + y0 + q, _mm256_add_ps(b0r, b2r));
+            _mm256_storeu_ps(yi + y0 + q, _mm256_add_ps(b0i, b2i));
+            auto cr = _mm256_add_ps(b1r, b3r), ci = _mm256_add_ps(b1i, b3i);
+            _mm256_storeu_ps(yr + y1 + q, _mm256_fmsub_ps(cr, twr[1], _mm256_mul_ps(ci, twi[1])));
+            _mm256_storeu_ps(yi + y1 + q, _mm256_fmadd_ps(cr, twi[1], _mm256_mul_ps(ci, twr[1])));
+            cr = _mm256_sub_ps(b0r, b2r), ci = _mm256_sub_ps(b0i, b2i);
+            _mm256_storeu_ps(yr + y2 + q, _mm256_fmsub_ps(cr, twr[2], _mm256_mul_ps(ci, twi[2])));
+            _mm256_storeu_ps(yi + y2 + q, _mm256_fmadd_ps(cr, twi[2], _mm256_mul_ps(ci, twr[2])));
+            cr = _mm256_sub_ps(b1r, b3r), ci = _mm256_sub_ps(b1i, b3i);
+            _mm256_storeu_ps(yr + y3 + q, _mm256_fmsub_ps(cr, twr[3], _mm256_mul_ps(ci, twi[3])));
+            _mm256_storeu_ps(yi + y3 + q, _mm256_fmadd_ps(cr, twi[3], _mm256_mul_ps(ci, twr[3])));
+        }
+    }
+}
+#endif
+#if SEED_FFT_NEON
+void neonRadix4Stage(const float *xr, const float *xi, float *yr, float *yi, int stride, int quarter, const float *wr,
+                     const float *wi) {
+    for (int p = 0; p < quarter; p++) {
+        float32x4_t twr[4], twi[4];
+        for (int m = 1; m < 4; m++) {
+            twr[m] = vdupq_n_f32(wr[stride * p * m]);
+            twi[m] = vdupq_n_f32(wi[stride * p * m]);
+        }
+        const int x0 = stride * p, x1 = x0 + stride * quarter, x2 = x1 + stride * quarter, x3 = x2 + stride * quarter;
+        const int y0 = stride * 4 * p, y1 = y0 + stride, y2 = y1 + stride, y3 = y2 + stride;
+        for (int q = 0; q < stride; q += 4) {
+            auto a0r = vld1q_f32(xr + x0 + q), a0i = vld1q_f32(xi + x0 + q);
+            auto a1r = vld1q_f32(xr + x1 + q), a1i = vld1q_f32(xi + x1 + q);
+            auto a2r = vld1q_f32(xr + x2 + q), a2i = vld1q_f32(xi + x2 + q);
+            auto a3r = vld1q_f32(xr + x3 + q), a3i = vld1q_f32(xi + x3 + q);
+            auto b0r = vaddq_f32(a0r, a2r), b0i = vaddq_f32(a0i, a2i);
+            auto b1r = vsubq_f32(a0r, a2r), b1i = vsubq_f32(a0i, a2i);
+            auto b2r = vaddq_f32(a1r, a3r), b2i = vaddq_f32(a1i, a3i);
+            auto b3r = vsubq_f32(a1i, a3i), b3i = vsubq_f32(a3r, a1r);
+            vst1q_f32(yr + y0 + q, vaddq_f32(b0r, b2r));
+            vst1q_f32(yi + y0 + q, vaddq_f32(b0i, b2i));
+            auto cr = vaddq_f32(b1r, b3r), ci = vaddq_f32(b1i, b3i);
+            vst1q_f32(yr + y1 + q, vmlsq_f32(vmulq_f32(cr, twr[1]), ci, twi[1]));
+            vst1q_f32(yi + y1 + q, vmlaq_f32(vmulq_f32(cr, twi[1]), ci, twr[1]));
+            cr = vsubq_f32(b0r, b2r), ci = vsubq_f32(b0i, b2i);
+            vst1q_f32(yr + y2 + q, vmlsq_f32(vmulq_f32(cr, twr[2]), ci, twi[2]));
+            vst1q_f32(yi + y2 + q, vmlaq_f32(vmulq_f32(cr, twi[2]), ci, twr[2]));
+            cr = vsubq_f32(b1r, b3r), ci = vsubq_f32(b1i, b3i);
+            vst1q_f32(yr + y3 + q, vmlsq_f32(vmulq_f32(cr, twr[3]), ci, twi[3]));
+            vst1q_f32(yi + y3 + q, vmlaq_f32(vmulq_f32(cr, twi[3]), ci, twr[3]));
+        }
+    }
+}
+#endif
+
+}  // namespace
+
+//==============================================================================
+void StereoFft::performFrequencyOnlyForwardTransform(const float *left,
+                                                     const float *right,
+                                                     float *const *magnitudes) {
+    const float *zr;
+    const float *zi;
+    transform(left, right, zr, zi);
+    auto size = getSize();
+    auto *mid = magnitudes[(int)StereoChannel::MID];
+    auto *side = magnitudes[(int)StereoChannel::SIDE];
+    auto *l = magnitudes[(int)StereoChannel::LEFT];
+    auto *r = magnitudes[(int)StereoChannel::RIGHT];
+    // Z = L + i R, so L[k] = (Z[k] + conj(Z[size - k])) / 2 and R[k] = -i (Z[k] - conj(Z[size - k])) / 2
+    for (int k = 0; k <= size / 2; k++) {
+        auto ar = zr[k & (size - 1)];
+        auto ai = zi[k & (size - 1)];
+        auto br = zr[(size - k) & (size - 1)];
+        auto bi = zi[(size - k) & (size - 1)];
+        auto lr = (ar + br) * 0.5f;
+        auto li = (ai - bi) * 0.5f;
+        auto rr = (ai + bi) * 0.5f;
+        auto ri = (br - ar) * 0.5f;
+        auto mr = (lr + rr) * 0.5f;
+        auto mi = (li + ri) * 0.5f;
+        auto sr = (lr - rr) * 0.5f;
+        auto si = (li - ri) * 0.5f;
+        l[k] = std::sqrt(lr * lr + li * li);
+        r[k] = std::sqrt(rr * rr + ri * ri);
+        mid[k] = std::sqrt(mr * mr + mi * mi);
+        side[k] = std::sqrt(sr * sr + si * si);
+    }
+}
+std::unique_ptr<StereoFft> StereoFft::create(int order) {
+#if SEED_FFT_SIMD
+    return std::make_unique<SimdStereoFft>(order);
+#else
+    return std::make_unique<JuceStereoFft>(order);
+#endif
+}
+
+//==============================================================================
+ComplexSimdFft::ComplexSimdFft(int order, Instructions instructions)
+    : instructions(instructions), vectorStage(radix4Stage), width(1), order(order), size(1 << order) {
+    switch (instructions) {
+#if JUCE_INTEL
+        case Instructions::SSE:
+            vectorStage = sseRadix4Stage;
+            width = 4;
+            break;
+        case Instructions::AVX2:
+            vectorStage = avx2Radix4Stage;
+            width = 8;
+            break;
+#endif
+#if SEED_FFT_NEON
+        case Instructions::NEON:
+            vectorStage = neonRadix4Stage;
+            width = 4;
+            break;
+#endif
+        default:
+            this->instructions = Instructions::SCALAR;
+            break;
+    }
+    twiddleRe.resize(size);
+    twiddleIm.resize(size);
+    for (int j = 0; j < size; j++) {
+        auto angle = -juce::MathConstants<double>::twoPi * j / size;
+        twiddleRe[j] = (float)std::cos(angle);
+        twiddleIm[j] = (float)std::sin(angle);
+    }
+    for (int i = 0; i < 2; i++) {
+        bufferRe[i].resize(size);
+        bufferIm[i].resize(size);
+    }
+}
+void ComplexSimdFft::perform(const float *&re, const float *&im) {
+    auto *xr = bufferRe[0].data();
+    auto *xi = bufferIm[0].data();
+    auto *yr = bufferRe[1].data();
+    auto *yi = bufferIm[1].data();
+    auto stride = 1;
+    if (order % 2 == 1) {
+        // the odd one out
+        radix2Stage(xr, xi, yr, yi, stride, size / 2, twiddleRe.data(), twiddleIm.data());
+        std::swap(xr, yr);
+        std::swap(xi, yi);
+        stride = 2;
+    }
+    for (; stride < size; stride *= 4) {
+        auto stage = stride >= width ? vectorStage : radix4Stage;
+        stage(xr, xi, yr, yi, stride, size / stride / 4, twiddleRe.data(), twiddleIm.data());
+        std::swap(xr, yr);
+        std::swap(xi, yi);
+    }
+    re = xr;
+    im = xi;
+}
+ComplexSimdFft::Instructions ComplexSimdFft::getBestInstructions() {
+#if JUCE_INTEL
+    if (juce::SystemStats::hasAVX2() && juce::SystemStats::hasFMA3()) {
+        return Instructions::AVX2;
+    }
+    return juce::SystemStats::hasSSE2() ? Instructions::SSE : Instructions::SCALAR;
+#elif SEED_FFT_NEON
+    return Instructions::NEON;
+#else
+    return Instructions::SCALAR;
+#endif
+}
+
+//==============================================================================
+JuceStereoFft::JuceStereoFft(int order)
+    : StereoFft(order),
+      fft(order),
+      input(1 << order),
+      output(1 << order),
+      spectrumRe(1 << order),
+      spectrumIm(1 << order) {}
+void JuceStereoFft::transform(const float *left, const float *right, const float *&re, const float *&im) {
+    auto size = getSize();
+    for (int i = 0; i < size; i++) {
+        input[i] = {left[i], right[i]};
+    }
+    fft.perform(input.data(), output.data(), false);
+    for (int k = 0; k < size; k++) {
+        spectrumRe[k] = output[k].real();
+        spectrumIm[k] = output[k].imag();
+    }
+    re = spectrumRe.data();
+    im = spectrumIm.data();
+}
+
+//==============================================================================
+SimdStereoFft::SimdStereoFft(int order, Instructions instructions)
+    : StereoFft(order), complexFft(order, instructions) {}
+void SimdStereoFft::transform(const float *left, const float *right, const float *&re, const float *&im) {
+    std::copy(left, left + getSize(), complexFft.getInputRe());
+    std::copy(right, right + getSize(), complexFft.getInputIm());
+    complexFft.perform(re, im);
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+// L, R and their mid (L + R) / 2 and side (L - R) / 2
+enum class StereoChannel { MID, SIDE, LEFT, RIGHT };
+
+// Forward FFT of stereo frames for the analysers. L and R are packed as the real and imaginary parts of one complex
+// frame, and the spectra of all four channels are separated from its result, for the cost of a single complex
+// transform.
+// `create` returns the backend chosen with SEED_FFT_BACKEND in src/CMakeLists.txt: JuceStereoFft, on juce::dsp::FFT,
+// which uses IPP, FFTW or vDSP where they are available, or SimdStereoFft.
+class StereoFft {
+public:
+    enum { numChannels = 4 };
+
+    virtual ~StereoFft(){};
+    StereoFft(const StereoFft &) = delete;
+
+    int getSize() const { return 1 << order; }
+    // `left` and `right` hold getSize() samples each; the magnitudes of bins 0..getSize() / 2 of each channel are
+    // written to magnitudes[(int)channel], scaled as juce::dsp::FFT::performFrequencyOnlyForwardTransform does
+    void performFrequencyOnlyForwardTransform(const float *left, const float *right, float *const *magnitudes);
+
+    static std::unique_ptr<StereoFft> create(int order);
+
+protected:
+    StereoFft(int order) : order(order){};
+
+    // the spectrum of left + i * right, valid until the next call
+    virtual void transform(const float *left, const float *right, const float *&re, const float *&im) = 0;
+
+    const int order;
+};
+
+//==============================================================================
+// In-tree complex FFT for builds where juce::dsp::FFT falls back to its generic implementation (Linux without IPP or
+// FFTW). It is a radix-4 Stockham FFT on separate real and imaginary arrays: it needs no bit reversal, and the
+// butterflies of every stage but the first one or two run on contiguous vectors with SSE, AVX2 or NEON, whichever is
+// the best the CPU supports.
+class ComplexSimdFft {
+public:
+    enum class Instructions { SCALAR, SSE, AVX2, NEON };
+
+    ComplexSimdFft(int order, Instructions instructions);
+    ComplexSimdFft(const ComplexSimdFft &) = delete;
+
+    int getSize() const { return size; }
+    Instructions getInstructions() const { return instructions; }
+    // the frame to transform, getSize() samples each
+    float *getInputRe() { return bufferRe[0].data(); }
+    float *getInputIm() { return bufferIm[0].data(); }
+    // transforms the input, which is lost, and points `re` and `im` to the spectrum
+    void perform(const float *&re, const float *&im);
+
+    // the widest this build and CPU can run
+    static Instructions getBestInstructions();
+
+private:
+    using Stage = void (*)(const float *xr, const float *xi, float *yr, float *yi, int stride, int count,
+                           const float *wr, const float *wi);
+
+    Instructions instructions;
+    // radix-4, for stages with at least `width` butterflies per twiddle
+    Stage vectorStage;
+    int width;
+    int order;
+    int size;
+    // exp(-2 pi i j / size)
+    std::vector<float> twiddleRe;
+    std::vector<float> twiddleIm;
+    // the stages go back and forth between these
+    std::vector<float> bufferRe[2];
+    std::vector<float> bufferIm[2];
+};
+
+//==============================================================================
+class JuceStereoFft : public StereoFft {
+public:
+    JuceStereoFft(int order);
+    ~JuceStereoFft() override{};
+
+protected:
+    void transform(const float *left, const float *right, const float *&re, const float *&im) override;
+
+private:
+    juce::dsp::FFT fft;
+    std::vector<juce::dsp::Complex<float>> input;
+    std::vector<juce::dsp::Complex<float>> output;
+    std::vector<float> spectrumRe;
+    std::vector<float> spectrumIm;
+};
+
+//==============================================================================
+class SimdStereoFft : public StereoFft {
+public:
+    using Instructions = ComplexSimdFft::Instructions;
+
+    SimdStereoFft(int order, Instructions instructions = ComplexSimdFft::getBestInstructions());
+    ~SimdStereoFft() override{};
+
+    Instructions getInstructions() const { return complexFft.getInstructions(); }
+
+protected:
+    void transform(const float *left, const float *right, const float *&re, const float *&im) override;
+
+private:
+    ComplexSimdFft complexFft;
+};
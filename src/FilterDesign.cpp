@@ -0,0 +1,157 @@
+#include "FilterDesign.h"
+
+namespace {
+// zeroth order modified Bessel function of the first kind
+double besselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 50; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-16) {
+            break;
+        }
+    }
+    return sum;
+}
+}  // namespace
+
+//==============================================================================
+std::shared_ptr<const ConvolutionKernel> KernelDesigner::design(const KernelSpec &spec) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto it = cache.begin(); it != cache.end(); ++it) {
+            if (it->first == spec) {
+                cache.splice(cache.begin(), cache, it);
+                return it->second;
+            }
+        }
+    }
+    auto taps = designTaps(spec);
+    auto kernel = std::make_shared<const ConvolutionKernel>(taps.data(), (int)taps.size(), blockSize);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    cache.emplace_front(spec, kernel);
+    while ((int)cache.size() > cacheSize) {
+        cache.pop_back();
+    }
+    return kernel;
+}
+std::vector<float> KernelDesigner::designTaps(const KernelSpec &spec) {
+    auto h = std::vector<double>(spec.n + 1, 0.0);
+    if (spec.highFreq < spec.sampleRate / 2 || spec.n % 2 != 0) {
+        addLowPass(h, std::min(spec.highFreq, spec.sampleRate / 2), spec.sampleRate, 1.0);
+    } else {
+        h[spec.n / 2] += 1.0;
+    }
+    if (spec.lowFreq > 0) {
+        addLowPass(h, spec.lowFreq, spec.sampleRate, -1.0);
+    }
+    std::vector<float> taps(h.size());
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto &window = getWindow(spec.window, spec.n, spec.kaiserBeta);
+        for (size_t i = 0; i < h.size(); i++) {
+            taps[i] = (float)(h[i] * window[i]);
+        }
+    }
+    return taps;
+}
+void KernelDesigner::addLowPass(std::vector<double> &h, double cutoff, double sampleRate, double sign) {
+    // 2 fc sinc(wc (n - N/2)), with sin(wc (n - N/2)) advanced by rotation
+    int filterN = (int)h.size() - 1;
+    double fc = cutoff / sampleRate;
+    double wc = fc * juce::MathConstants<double>::twoPi;
+    double s = std::sin(-wc * filterN / 2);
+    double c = std::cos(-wc * filterN / 2);
+    double sd = std::sin(wc);
+    double cd = std::cos(wc);
+    for (int n = 0; n <= filterN; n++) {
+        double n1 = n - (double)filterN / 2;
+        double sinc = n1 == 0 ? 1 : s / (wc * n1);
+        h[n] += sign * 2.0 * fc * sinc;
+        auto nextS = s * cd + c * sd;
+        c = c * cd - s * sd;
+        s = nextS;
+    }
+}
+KernelSpec KernelDesigner::minimalSpec(
+    float lowFreq, float highFreq, float sampleRate, float transitionRatio, float attenuation, int maxN) {
+    auto nyquist = sampleRate / 2;
+    KernelSpec spec{0, lowFreq, highFreq, sampleRate, FilterWindow::Kaiser, kaiserBetaFor(attenuation)};
+    bool lowCut = lowFreq > 0;
+    bool highCut = highFreq < nyquist;
+    if (!lowCut && !highCut) {
+        return spec;
+    }
+    // the narrowest transition band decides the order. transition bands are centred on the edges, so they must not
+    // cross DC, Nyquist or each other.
+    double transition = nyquist;
+    if (lowCut) {
+        transition = std::min({transition, (double)lowFreq * transitionRatio, 2.0 * lowFreq});
+    }
+    if (highCut) {
+        transition = std::min({transition, (double)highFreq * transitionRatio, 2.0 * (nyquist - highFreq)});
+    }
+    if (lowCut && highCut) {
+        transition = std::min(transition, (double)(highFreq - lowFreq));
+    }
+    auto deltaOmega = juce::MathConstants<double>::twoPi * std::max(transition, 1e-3) / sampleRate;
+    auto n = (std::max(attenuation, 21.0f) - 7.95) / (2.285 * deltaOmega);
+    // even, so that the delay is a whole number of samples
+    spec.n = juce::jlimit(2, maxN / 2 * 2, (int)std::ceil(std::min(n, (double)maxN) / 2) * 2);
+    return spec;
+}
+double KernelDesigner::kaiser(double x, float beta) {
+    return besselI0(beta * std::sqrt(std::max(0.0, 1.0 - 4.0 * x * x))) / besselI0(beta);
+}
+float KernelDesigner::kaiserBetaFor(float attenuation) {
+    if (attenuation > 50) {
+        return 0.1102f * (attenuation - 8.7f);
+    }
+    if (attenuation >= 21) {
+        return 0.5842f * std::pow(attenuation - 21, 0.4f) + 0.07886f * (attenuation - 21);
+    }
+    return 0.0f;
+}
+const std::vector<double> &KernelDesigner::getWindow(FilterWindow window, int n, float kaiserBeta) {
+    auto key = std::make_tuple(window, n, window == FilterWindow::Kaiser ? kaiserBeta : 0.0f);
+    for (auto it = windows.begin(); it != windows.end(); ++it) {
+        if (it->first == key) {
+            windows.splice(windows.begin(), windows, it);
+            return it->second;
+        }
+    }
+    windows.emplace_front(key, calculateWindow(window, n, kaiserBeta));
+    while ((int)windows.size() > cacheSize) {
+        windows.pop_back();
+    }
+    return windows.front().second;
+}
+std::vector<double> KernelDesigner::calculateWindow(FilterWindow window, int n, float kaiserBeta) {
+    constexpr auto pi = juce::MathConstants<double>::pi;
+    std::vector<double> w(n + 1, 1.0);
+    if (n <= 0) {
+        return w;
+    }
+    for (int i = 0; i <= n; i++) {
+        // centred: x = 0 in the middle of the kernel
+        double x = (i - (double)n / 2) / n;
+        switch (window) {
+            case FilterWindow::Blackman:
+                w[i] = 0.42 + 0.5 * std::cos(2 * pi * x) + 0.08 * std::cos(4 * pi * x);
+                break;
+            case FilterWindow::Hann:
+                w[i] = 0.5 + 0.5 * std::cos(2 * pi * x);
+                break;
+            case FilterWindow::Kaiser:
+                w[i] = kaiser(x, kaiserBeta);
+                break;
+            case FilterWindow::BlackmanHarris:
+                w[i] = 0.35875 + 0.48829 * std::cos(2 * pi * x) + 0.14128 * std::cos(4 * pi * x) +
+                       0.01168 * std::cos(6 * pi * x);
+                break;
+        }
+    }
+    return w;
+}
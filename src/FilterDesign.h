@@ -0,0 +1,62 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <list>
+
+#include "Convolver.h"
+
+enum class FilterWindow { Blackman, Hann, Kaiser, BlackmanHarris };
+
+//==============================================================================
+// lowFreq <= 0 leaves the low side open, highFreq >= sampleRate / 2 leaves the high side open
+struct KernelSpec {
+    int n = 100;
+    float lowFreq = 20;
+    float highFreq = 20000;
+    float sampleRate = 48000;
+    FilterWindow window = FilterWindow::Blackman;
+    // only used by FilterWindow::Kaiser
+    float kaiserBeta = 8.6f;
+
+    bool operator==(const KernelSpec &other) const {
+        return n == other.n && lowFreq == other.lowFreq && highFreq == other.highFreq &&
+               sampleRate == other.sampleRate && window == other.window &&
+               (window != FilterWindow::Kaiser || kaiserBeta == other.kaiserBeta);
+    }
+};
+
+//==============================================================================
+// Designs windowed-sinc band-pass kernels (n + 1 taps, linear phase).
+// Designed kernels and their window tables are kept in small LRU caches, so replaying or switching back to a recent
+// setting costs nothing. Thread-safe.
+class KernelDesigner {
+public:
+    KernelDesigner(int blockSize, int cacheSize = 16) : blockSize(blockSize), cacheSize(cacheSize){};
+    ~KernelDesigner(){};
+    KernelDesigner(const KernelDesigner &) = delete;
+
+    std::shared_ptr<const ConvolutionKernel> design(const KernelSpec &spec);
+    std::vector<float> designTaps(const KernelSpec &spec);
+
+    // symmetric window of n + 1 points
+    static std::vector<double> calculateWindow(FilterWindow window, int n, float kaiserBeta);
+    // Kaiser-windowed spec of the smallest even order whose transition bands are at most `transitionRatio` times
+    // their band edge wide and whose stopband is attenuated by `attenuation` dB (Kaiser's estimate), up to `maxN`
+    static KernelSpec minimalSpec(
+        float lowFreq, float highFreq, float sampleRate, float transitionRatio, float attenuation, int maxN);
+    static float kaiserBetaFor(float attenuation);
+    // Kaiser window at `x` in [-0.5, 0.5] (relative to its length)
+    static double kaiser(double x, float beta);
+
+private:
+    int blockSize;
+    int cacheSize;
+    std::mutex mutex;
+    // most recently used first
+    std::list<std::pair<KernelSpec, std::shared_ptr<const ConvolutionKernel>>> cache;
+    std::list<std::pair<std::tuple<FilterWindow, int, float>, std::vector<double>>> windows;
+
+    const std::vector<double> &getWindow(FilterWindow window, int n, float kaiserBeta);
+    static void addLowPass(std::vector<double> &h, double cutoff, double sampleRate, double sign);
+};
@@ -0,0 +1,106 @@
+#include "HeatMap.h"
+
+namespace {
+// matplotlib's maps sampled at 9 points
+const juce::uint32 VIRIDIS[] = {
+    0xff440154, 0xff472d7b, 0xff3b528b, 0xff2c728e, 0xff21918c, 0xff28ae80, 0xff5ec962, 0xffaddc30, 0xfffde725};
+const juce::uint32 INFERNO[] = {
+    0xff000004, 0xff1f0c48, 0xff550f6d, 0xff88226a, 0xffba3655, 0xffe35933, 0xfff98e09, 0xfff9cb35, 0xfffcffa4};
+}  // namespace
+
+//==============================================================================
+HeatMapRenderer::HeatMapRenderer(const SpectrogramCalculator &spectrogram)
+    : juce::Thread("Heat Map Renderer"),
+      spectrogram(spectrogram),
+      front(juce::Image::PixelFormat::ARGB,
+            spectrogram.getSpec().numColumns,
+            spectrogram.getSpec().numBins,
+            true,
+            juce::SoftwareImageType()),
+      back(juce::Image::PixelFormat::ARGB,
+           spectrogram.getSpec().numColumns,
+           spectrogram.getSpec().numBins,
+           true,
+           juce::SoftwareImageType()) {
+    startThread();
+}
+HeatMapRenderer::~HeatMapRenderer() {
+    signalThreadShouldExit();
+    notify();
+    stopThread(1000);
+}
+bool HeatMapRenderer::request(const HeatMapStyle &newStyle) {
+    if (state.load() != State::IDLE) {
+        return false;
+    }
+    style = newStyle;
+    state.store(State::DRAWING, std::memory_order_release);
+    notify();
+    return true;
+}
+bool HeatMapRenderer::takeImage(juce::Image &image) {
+    if (state.load(std::memory_order_acquire) != State::DONE) {
+        return false;
+    }
+    std::swap(front, back);
+    image = front;
+    state = State::IDLE;
+    return true;
+}
+void HeatMapRenderer::cancel() {
+    while (state.load(std::memory_order_acquire) == State::DRAWING) {
+        std::this_thread::yield();
+    }
+    state = State::IDLE;
+}
+void HeatMapRenderer::run() {
+    while (!threadShouldExit()) {
+        if (state.load(std::memory_order_acquire) == State::DRAWING) {
+            prepareTable();
+            draw();
+            state.store(State::DONE, std::memory_order_release);
+        }
+        wait(-1);
+    }
+}
+void HeatMapRenderer::prepareTable() {
+    auto &spec = spectrogram.getSpec();
+    auto range = style.ceilingdB - style.floordB;
+    for (int level = 0; level <= SpectrogramCalculator::maxLevel; level++) {
+        auto dB = juce::jmap((float)level, 0.0f, (float)SpectrogramCalculator::maxLevel, spec.mindB, spec.maxdB);
+        auto t = range > 0 ? juce::jlimit(0.0f, 1.0f, (dB - style.floordB) / range) : (float)(dB >= style.floordB);
+        table[level] = getColour(style.colourMap, t).getPixelARGB();
+    }
+}
+void HeatMapRenderer::draw() {
+    auto &spec = spectrogram.getSpec();
+    if (back.getWidth() != spec.numColumns || back.getHeight() != spec.numBins) {
+        // drawn off the message thread, so it must not be backed by a native (e.g. GPU) image
+        back = juce::Image(
+            juce::Image::PixelFormat::ARGB, spec.numColumns, spec.numBins, false, juce::SoftwareImageType());
+    }
+    // the columns that are ready now; later ones are drawn next time
+    columns.resize(spec.numColumns);
+    for (int t = 0; t < spec.numColumns; t++) {
+        columns[t] = spectrogram.isReady(t) ? spectrogram.getColumn(t) : nullptr;
+    }
+    auto empty = juce::Colours::black.getPixelARGB();
+    juce::Image::BitmapData pixels(back, juce::Image::BitmapData::writeOnly);
+    for (int y = 0; y < spec.numBins; y++) {
+        auto *row = reinterpret_cast<juce::PixelARGB *>(pixels.getLinePointer(y));
+        // the lowest frequency at the bottom
+        auto bin = spec.numBins - 1 - y;
+        for (int t = 0; t < spec.numColumns; t++) {
+            row[t] = columns[t] != nullptr ? table[columns[t][bin]] : empty;
+        }
+    }
+}
+juce::Colour HeatMapRenderer::getColour(ColourMap colourMap, float t) {
+    if (colourMap == ColourMap::GREY) {
+        return juce::Colour::greyLevel(t);
+    }
+    const auto *stops = colourMap == ColourMap::VIRIDIS ? VIRIDIS : INFERNO;
+    auto position = t * 8;
+    auto index = std::min((int)position, 7);
+    return juce::Colour(stops[index]).interpolatedWith(juce::Colour(stops[index + 1]), position - index);
+}
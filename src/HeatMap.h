@@ -0,0 +1,59 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "Spectrogram.h"
+
+//==============================================================================
+enum class ColourMap { GREY, VIRIDIS, INFERNO };
+
+struct HeatMapStyle {
+    ColourMap colourMap = ColourMap::GREY;
+    // shown from the darkest to the brightest colour, within the range of the spectrogram
+    float floordB = -100;
+    float ceilingdB = 0;
+
+    bool operator==(const HeatMapStyle &other) const {
+        return colourMap == other.colourMap && floordB == other.floordB && ceilingdB == other.ceilingdB;
+    }
+    bool operator!=(const HeatMapStyle &other) const { return !(*this == other); }
+};
+
+//==============================================================================
+// Draws the ready columns of a spectrogram into an image of a pixel per level on a background thread.
+// A table maps each of the 256 quantized levels straight to a pixel for the current colours and dB range, and the rows
+// of the image are written through BitmapData, so changing the style only redraws and a redraw is one lookup per
+// pixel. The image is double-buffered: the thread draws into the back image while the GUI shows the front one, and
+// they are swapped when the GUI takes the result.
+class HeatMapRenderer : private juce::Thread {
+public:
+    HeatMapRenderer(const SpectrogramCalculator &spectrogram);
+    ~HeatMapRenderer() override;
+    HeatMapRenderer(const HeatMapRenderer &) = delete;
+
+    // GUI thread: false while the previous drawing is in progress or has not been taken
+    bool request(const HeatMapStyle &style);
+    // GUI thread: the newly drawn image, which stays untouched until the next one is taken
+    bool takeImage(juce::Image &image);
+    // GUI thread: waits for the drawing in progress and drops it, e.g. before the spectrogram starts over
+    void cancel();
+
+private:
+    enum class State { IDLE, DRAWING, DONE };
+
+    const SpectrogramCalculator &spectrogram;
+    juce::Image front;
+    juce::Image back;
+    // written by the GUI thread while IDLE
+    HeatMapStyle style;
+    std::atomic<State> state{State::IDLE};
+    // background thread
+    std::array<juce::PixelARGB, SpectrogramCalculator::maxLevel + 1> table;
+    std::vector<const SpectrogramCalculator::Level *> columns;
+
+    void run() override;
+    void prepareTable();
+    void draw();
+    // t in 0..1
+    static juce::Colour getColour(ColourMap colourMap, float t);
+};
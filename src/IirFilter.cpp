@@ -0,0 +1,105 @@
+#include "IirFilter.h"
+
+//==============================================================================
+BiquadCascade::BiquadCascade(const IirSpec &spec) {
+    if (spec.lowFreq > 0) {
+        addSections(spec.lowFreq, spec.sampleRate, spec.order, true);
+    }
+    if (spec.highFreq < spec.sampleRate / 2) {
+        addSections(spec.highFreq, spec.sampleRate, spec.order, false);
+    }
+}
+void BiquadCascade::addSections(double freq, double sampleRate, int order, bool highPass) {
+    constexpr auto pi = juce::MathConstants<double>::pi;
+    auto w0 = 2 * pi * freq / sampleRate;
+    if (order % 2 != 0) {
+        // first-order section, bilinear transform
+        auto k = std::tan(w0 / 2);
+        auto a1 = (k - 1) / (k + 1);
+        if (highPass) {
+            sections.push_back(Section{1 / (1 + k), -1 / (1 + k), 0, a1, 0});
+        } else {
+            sections.push_back(Section{k / (1 + k), k / (1 + k), 0, a1, 0});
+        }
+    }
+    auto cosW0 = std::cos(w0);
+    auto sinW0 = std::sin(w0);
+    for (int k = 1; k <= order / 2; k++) {
+        // Q of each pole pair of the Butterworth polynomial
+        auto q = 1 / (2 * std::sin(pi * (2 * k - 1) / (2.0 * order)));
+        auto alpha = sinW0 / (2 * q);
+        auto a0 = 1 + alpha;
+        auto b1 = highPass ? -(1 + cosW0) : 1 - cosW0;
+        auto b0 = std::abs(b1) / 2;
+        sections.push_back(Section{b0 / a0, b1 / a0, b0 / a0, -2 * cosW0 / a0, (1 - alpha) / a0});
+    }
+}
+int BiquadCascade::getDecayLength(double attenuation) const {
+    // the pole nearest to the unit circle decays the slowest
+    double radius = 0;
+    for (auto &section : sections) {
+        auto discriminant = section.a1 * section.a1 - 4 * section.a2;
+        radius = std::max(radius,
+                          discriminant < 0 ? std::sqrt(section.a2)
+                                           : (std::abs(section.a1) + std::sqrt(discriminant)) / 2);
+    }
+    if (radius <= 0 || radius >= 1) {
+        return 0;
+    }
+    return (int)std::ceil(-attenuation / 20 * std::log(10.0) / std::log(radius));
+}
+void BiquadCascade::processForward(State &state, float *dataL, float *dataR, int numSamples) const {
+    jassert(state.z.size() == sections.size());
+    for (size_t i = 0; i < sections.size(); i++) {
+        processSection(sections[i], state.z[i].data(), dataL, dataR, numSamples, false);
+    }
+}
+void BiquadCascade::processBackward(float *dataL, float *dataR, int numSamples) const {
+    for (auto &section : sections) {
+        double z[4]{};
+        processSection(section, z, dataL, dataR, numSamples, true);
+    }
+}
+void BiquadCascade::processSection(
+    const Section &section, double *z, float *dataL, float *dataR, int numSamples, bool backward) const {
+    // transposed direct form II, in double so that low edges stay stable and quiet
+    double z1[2]{z[0], z[1]}, z2[2]{z[2], z[3]};
+    int start = backward ? numSamples - 1 : 0;
+    int step = backward ? -1 : 1;
+    for (int n = 0, i = start; n < numSamples; n++, i += step) {
+        double x[2]{dataL[i], dataR[i]};
+        double y[2];
+        for (int ch = 0; ch < 2; ch++) {
+            y[ch] = section.b0 * x[ch] + z1[ch];
+            z1[ch] = section.b1 * x[ch] - section.a1 * y[ch] + z2[ch];
+            z2[ch] = section.b2 * x[ch] - section.a2 * y[ch];
+        }
+        dataL[i] = (float)y[0];
+        dataR[i] = (float)y[1];
+    }
+    z[0] = z1[0];
+    z[1] = z1[1];
+    z[2] = z2[0];
+    z[3] = z2[1];
+}
+int BiquadCascade::minimalOrder(
+    float lowFreq, float highFreq, float sampleRate, float transitionRatio, float attenuation, int maxOrder) {
+    constexpr auto pi = juce::MathConstants<double>::pi;
+    auto nyquist = sampleRate / 2;
+    // ratio of the (prewarped) stopband edge to the passband edge, the smaller of the two sides decides
+    double ratio = std::numeric_limits<double>::max();
+    if (lowFreq > 0) {
+        auto stop = lowFreq * std::max(0.01, 1.0 - transitionRatio / 2);
+        ratio = std::min(ratio, std::tan(pi * lowFreq / sampleRate) / std::tan(pi * stop / sampleRate));
+    }
+    if (highFreq < nyquist) {
+        auto stop = std::min(highFreq * (1.0 + transitionRatio / 2), nyquist * 0.999);
+        ratio = std::min(ratio, std::tan(pi * stop / sampleRate) / std::tan(pi * highFreq / sampleRate));
+    }
+    if (ratio == std::numeric_limits<double>::max()) {
+        return 1;
+    }
+    // both passes: 20 log10(1 + ratio^(2 order)) >= attenuation
+    auto order = std::log10(std::pow(10.0, attenuation / 20.0) - 1) / (2 * std::log10(ratio));
+    return juce::jlimit(1, maxOrder, (int)std::ceil(order));
+}
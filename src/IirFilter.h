@@ -0,0 +1,57 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+// lowFreq <= 0 leaves the low side open, highFreq >= sampleRate / 2 leaves the high side open
+struct IirSpec {
+    // Butterworth order of each edge
+    int order = 4;
+    float lowFreq = 20;
+    float highFreq = 20000;
+    float sampleRate = 48000;
+};
+
+//==============================================================================
+// Butterworth band-pass (a high-pass and a low-pass of `order` each) as a cascade of biquads.
+// Run forward and then backward over a whole buffer it has zero phase and the squared magnitude, i.e. a
+// Linkwitz-Riley response of twice the order with -6 dB at the edges like the FIR kernels, for a few operations per
+// sample regardless of how narrow the band is.
+class BiquadCascade {
+public:
+    // the memory of each section in the forward pass, which carries over from one call to the next
+    struct State {
+        std::vector<std::array<double, 4>> z;
+    };
+
+    BiquadCascade(const IirSpec &spec);
+    ~BiquadCascade(){};
+
+    int getNumSections() const { return (int)sections.size(); }
+    // operations per sample (per channel) of a forward and a backward pass
+    double estimateCost() const { return 2.0 * 9.0 * getNumSections(); }
+    // the number of samples in which the impulse response decays by `attenuation` dB (at least 0)
+    int getDecayLength(double attenuation) const;
+    // starts from silence
+    State createState() const { return State{std::vector<std::array<double, 4>>(sections.size())}; }
+    // L and R go through each section together so that the recursion is vectorised across them
+    void processForward(State &state, float *dataL, float *dataR, int numSamples) const;
+    // over the output of the forward pass, starting from silence after the last sample
+    void processBackward(float *dataL, float *dataR, int numSamples) const;
+
+    // smallest order for which transition bands of `transitionRatio` times the band edge reach `attenuation` dB
+    // after both passes
+    static int minimalOrder(
+        float lowFreq, float highFreq, float sampleRate, float transitionRatio, float attenuation, int maxOrder);
+
+private:
+    struct Section {
+        double b0, b1, b2, a1, a2;
+    };
+    std::vector<Section> sections;
+
+    void addSections(double freq, double sampleRate, int order, bool highPass);
+    // z: z1 and z2 of L and R
+    void processSection(
+        const Section &section, double *z, float *dataL, float *dataR, int numSamples, bool backward) const;
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+// Single-producer single-consumer queue. Both push() and pop() are wait-free,
+// so it can be used to send messages to or from the audio thread.
+template <typename T, int Capacity>
+class LockFreeQueue {
+public:
+    LockFreeQueue(){};
+    ~LockFreeQueue(){};
+    LockFreeQueue(const LockFreeQueue &) = delete;
+
+    bool push(T value) {
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite(1, start1, size1, start2, size2);
+        if (size1 + size2 < 1) {
+            return false;
+        }
+        items[size1 > 0 ? start1 : start2] = std::move(value);
+        fifo.finishedWrite(1);
+        return true;
+    }
+    bool pop(T &value) {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(1, start1, size1, start2, size2);
+        if (size1 + size2 < 1) {
+            return false;
+        }
+        // moved out, so the queue does not keep a reference to the item
+        value = std::move(items[size1 > 0 ? start1 : start2]);
+        fifo.finishedRead(1);
+        return true;
+    }
+    int getNumReady() const { return fifo.getNumReady(); }
+    int getFreeSpace() const { return fifo.getFreeSpace(); }
+
+private:
+    juce::AbstractFifo fifo{Capacity};
+    std::array<T, Capacity> items{};
+};
@@ -0,0 +1,52 @@
+#include "LogFrequencyMap.h"
+
+//==============================================================================
+void LogFrequencyMap::prepare(int fftSize, float sampleRate, float minFreq, float maxFreq, int numBins) {
+    if (fftSize == preparedFftSize && sampleRate == preparedSampleRate && minFreq == preparedMinFreq &&
+        maxFreq == preparedMaxFreq && numBins == getNumBins()) {
+        return;
+    }
+    preparedFftSize = fftSize;
+    preparedSampleRate = sampleRate;
+    preparedMinFreq = minFreq;
+    preparedMaxFreq = maxFreq;
+    indices.resize(numBins);
+    fractions.resize(numBins);
+    for (int i = 0; i < numBins; i++) {
+        auto hz = minFreq * std::pow(maxFreq / minFreq, (float)i / numBins);
+        // between the two nearest FFT bins, below Nyquist
+        auto index = juce::jlimit(0.0f, fftSize / 2 - 1.0f, hz * fftSize / sampleRate);
+        indices[i] = std::min((int)index, fftSize / 2 - 1);
+        fractions[i] = index - indices[i];
+    }
+}
+void LogFrequencyMap::map(const float *magnitudes, float *levels, float mindB, float maxdB) const {
+    auto numBins = getNumBins();
+    const auto *index = indices.data();
+    const auto *fraction = fractions.data();
+    for (int i = 0; i < numBins; i++) {
+        auto low = magnitudes[index[i]];
+        auto high = magnitudes[index[i] + 1];
+        levels[i] = low + (high - low) * fraction[i];
+    }
+    fastLog2(levels, numBins);
+    // 20 * log10(x) = 20 * log10(2) * log2(x), relative to fftSize and mapped from mindB..maxdB to 0..1
+    constexpr float dBPerOctave = 6.0205999f;
+    auto range = maxdB - mindB;
+    auto offset = juce::Decibels::gainToDecibels((float)preparedFftSize) + mindB;
+    juce::FloatVectorOperations::multiply(levels, dBPerOctave / range, numBins);
+    juce::FloatVectorOperations::add(levels, -offset / range, numBins);
+    juce::FloatVectorOperations::clip(levels, levels, 0.0f, 1.0f, numBins);
+}
+void LogFrequencyMap::fastLog2(float *data, int size) {
+    for (int i = 0; i < size; i++) {
+        // x = m * 2^e with m in [1, 2)
+        uint32_t bits;
+        std::memcpy(&bits, data + i, sizeof(bits));
+        auto exponent = (float)((int)(bits >> 23) - 127);
+        bits = (bits & 0x007fffffu) | 0x3f800000u;
+        float m;
+        std::memcpy(&m, &bits, sizeof(m));
+        data[i] = exponent + (((0.15544585f * m - 1.0392582f) * m + 3.0294782f) * m - 2.1449406f);
+    }
+}
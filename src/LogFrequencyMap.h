@@ -0,0 +1,33 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+// Maps the magnitudes of an FFT frame to levels on a logarithmic frequency axis.
+// The FFT bin and blend weight of every output bin are tabulated once for a given FFT size, sample rate, range and
+// number of output bins. Mapping a frame then gathers and blends neighbouring magnitudes and converts them to dB with a
+// polynomial log2 on the float bits, in plain loops over arrays that the compiler vectorises.
+class LogFrequencyMap {
+public:
+    LogFrequencyMap(){};
+    ~LogFrequencyMap(){};
+
+    // non-audio thread: does nothing if nothing has changed
+    void prepare(int fftSize, float sampleRate, float minFreq, float maxFreq, int numBins);
+    int getNumBins() const { return (int)indices.size(); }
+    // `magnitudes` of the first fftSize / 2 + 1 bins to numBins levels 0..1 between mindB and maxdB, where 0 dB is a
+    // magnitude of fftSize
+    void map(const float *magnitudes, float *levels, float mindB, float maxdB) const;
+
+private:
+    int preparedFftSize = 0;
+    float preparedSampleRate = 0;
+    float preparedMinFreq = 0;
+    float preparedMaxFreq = 0;
+    // levels[i] blends magnitudes[indices[i]] and the next one by fractions[i]
+    std::vector<int> indices;
+    std::vector<float> fractions;
+
+    // accurate to about 0.005 dB
+    static void fastLog2(float *data, int size);
+};
@@ -1,5 +1,15 @@
 #include "Params.h"
 
+namespace {
+// Hosts automate the normalised value, so the range of a time parameter must not change again. It is skewed so that
+// short takes keep a fine resolution: the middle is 10 seconds.
+juce::NormalisableRange<float> makeTakeTimeRange(float start) {
+    juce::NormalisableRange<float> range(start, MAX_TAKE_SECONDS);
+    range.setSkewForCentre(10.0f);
+    return range;
+}
+}  // namespace
+
 //==============================================================================
 EntryParams::EntryParams(int index) {
     auto idPrefix = "E" + juce::String(index) + "_";
@@ -9,11 +19,12 @@ EntryParams::EntryParams(int index) {
         idPrefix + "FILTER_LOW_FREQ", namePrefix + "Filter low Freq", 20.0f, 20000.0f, 20.0f);
     FilterHighFreq = new juce::AudioParameterFloat(
         idPrefix + "FILTER_HIGH_FREQ", namePrefix + "Filter High Freq", 20.0f, 20000.0f, 20000.0f);
-    PlayStartSec =
-        new juce::AudioParameterFloat(idPrefix + "PLAY_START_SEC", namePrefix + "Play Start Sec", 0.0f, 4.0f, 0.0f);
+    PlayStartSec = new juce::AudioParameterFloat(
+        idPrefix + "PLAY_START_SEC", namePrefix + "Play Start Sec", makeTakeTimeRange(0.0f), 0.0f);
     FocusFreq =
         new juce::AudioParameterFloat(idPrefix + "FOCUS_FREQ", namePrefix + "Focus Freq", 20.0f, 20000.0f, 440.0f);
-    FocusSec = new juce::AudioParameterFloat(idPrefix + "FOCUS_SEC", namePrefix + "Focus Sec", 0.0f, 4.0f, 0.0f);
+    FocusSec = new juce::AudioParameterFloat(
+        idPrefix + "FOCUS_SEC", namePrefix + "Focus Sec", makeTakeTimeRange(0.0f), 0.0f);
 }
 void EntryParams::addAllParameters(juce::AudioProcessor& processor) {
     processor.addParameter(BaseFreq);
@@ -42,22 +53,118 @@ void EntryParams::loadParameters(juce::XmlElement& xml) {
 
 //==============================================================================
 AllParams::AllParams() : entryParams{EntryParams{0}, EntryParams{1}, EntryParams{2}, EntryParams{3}} {
+    RecSeconds = new juce::AudioParameterFloat("REC_SECONDS", "Rec Seconds", makeTakeTimeRange(1.0f), 4.0f);
+    RecToDisk = new juce::AudioParameterBool("REC_TO_DISK", "Rec To Disk", false);
+    RecTrigger = new juce::AudioParameterChoice(
+        "REC_TRIGGER", "Rec Trigger", juce::StringArray{"Level", "Onset", "MIDI"}, 0);
+    // -120 dB starts from the first sound
+    TriggerLevel = new juce::AudioParameterFloat("TRIGGER_LEVEL", "Trigger Level", -120.0f, 0.0f, -120.0f);
+    PreRollSec = new juce::AudioParameterFloat("PRE_ROLL_SEC", "Pre-roll Sec", 0.0f, 2.0f, 0.1f);
+    FilterMode = new juce::AudioParameterChoice("FILTER_MODE", "Filter Mode", juce::StringArray{"FIR", "IIR"}, 0);
+    FilterAuto = new juce::AudioParameterBool("FILTER_AUTO", "Filter Auto N", true);
     FilterN = new juce::AudioParameterInt("FILTER_N", "Filter N", 10, 400, 100);
+    FilterTransition = new juce::AudioParameterFloat("FILTER_TRANSITION", "Filter Transition", 0.05f, 1.0f, 0.5f);
+    FilterAttenuation =
+        new juce::AudioParameterFloat("FILTER_ATTENUATION", "Filter Attenuation", 20.0f, 120.0f, 60.0f);
+    // how long a filter retuned while playing takes to replace the previous one
+    FilterCrossfadeMs =
+        new juce::AudioParameterFloat("FILTER_CROSSFADE_MS", "Filter Crossfade Ms", 1.0f, 500.0f, 40.0f);
+    HeatMapColours = new juce::AudioParameterChoice(
+        "HEAT_MAP_COLOURS", "Heat Map Colours", juce::StringArray{"Grey", "Viridis", "Inferno"}, 0);
+    // in the order of StereoChannel
+    HeatMapChannel = new juce::AudioParameterChoice(
+        "HEAT_MAP_CHANNEL", "Heat Map Channel", juce::StringArray{"Mid", "Side", "Left", "Right"}, 0);
+    HeatMapFloor = new juce::AudioParameterFloat("HEAT_MAP_FLOOR", "Heat Map Floor", -100.0f, 0.0f, -100.0f);
+    HeatMapCeiling = new juce::AudioParameterFloat("HEAT_MAP_CEILING", "Heat Map Ceiling", -100.0f, 0.0f, 0.0f);
+    SpectrogramFftSize = new juce::AudioParameterChoice(
+        "SPECTROGRAM_FFT_SIZE",
+        "Spectrogram FFT Size",
+        juce::StringArray{"256", "512", "1024", "2048", "4096", "8192", "16384", "32768"},
+        4);
+    SpectrogramWindow = new juce::AudioParameterChoice("SPECTROGRAM_WINDOW",
+                                                       "Spectrogram Window",
+                                                       juce::StringArray{"Hann", "Hamming", "Blackman-Harris", "Rect"},
+                                                       0);
+    // in samples; Auto calculates a column per pixel of the heat map
+    SpectrogramHop = new juce::AudioParameterChoice(
+        "SPECTROGRAM_HOP",
+        "Spectrogram Hop",
+        juce::StringArray{"Auto", "128", "256", "512", "1024", "2048", "4096"},
+        0);
+    // the FFT size applies to the lowest frequencies
+    SpectrogramMultiResolution =
+        new juce::AudioParameterBool("SPECTROGRAM_MULTI_RESOLUTION", "Spectrogram Multi-Resolution", false);
 }
 void AllParams::addAllParameters(juce::AudioProcessor& processor) {
     processor.addParameter(FilterN);
     for (auto& params : entryParams) {
         params.addAllParameters(processor);
     }
+    // hosts refer to parameters by index: new ones are only ever appended
+    processor.addParameter(FilterAuto);
+    processor.addParameter(FilterTransition);
+    processor.addParameter(FilterAttenuation);
+    processor.addParameter(FilterMode);
+    processor.addParameter(RecSeconds);
+    processor.addParameter(RecToDisk);
+    processor.addParameter(RecTrigger);
+    processor.addParameter(TriggerLevel);
+    processor.addParameter(PreRollSec);
+    processor.addParameter(HeatMapColours);
+    processor.addParameter(HeatMapFloor);
+    processor.addParameter(HeatMapCeiling);
+    processor.addParameter(SpectrogramFftSize);
+    processor.addParameter(SpectrogramWindow);
+    processor.addParameter(SpectrogramHop);
+    processor.addParameter(HeatMapChannel);
+    processor.addParameter(SpectrogramMultiResolution);
+    processor.addParameter(FilterCrossfadeMs);
 }
 void AllParams::saveParameters(juce::XmlElement& xml) {
+    xml.setAttribute(RecSeconds->paramID, (double)RecSeconds->get());
+    xml.setAttribute(RecToDisk->paramID, RecToDisk->get());
+    xml.setAttribute(RecTrigger->paramID, RecTrigger->getIndex());
+    xml.setAttribute(TriggerLevel->paramID, (double)TriggerLevel->get());
+    xml.setAttribute(PreRollSec->paramID, (double)PreRollSec->get());
+    xml.setAttribute(FilterMode->paramID, FilterMode->getIndex());
+    xml.setAttribute(FilterAuto->paramID, FilterAuto->get());
     xml.setAttribute(FilterN->paramID, FilterN->get());
+    xml.setAttribute(FilterTransition->paramID, (double)FilterTransition->get());
+    xml.setAttribute(FilterAttenuation->paramID, (double)FilterAttenuation->get());
+    xml.setAttribute(FilterCrossfadeMs->paramID, (double)FilterCrossfadeMs->get());
+    xml.setAttribute(HeatMapColours->paramID, HeatMapColours->getIndex());
+    xml.setAttribute(HeatMapChannel->paramID, HeatMapChannel->getIndex());
+    xml.setAttribute(HeatMapFloor->paramID, (double)HeatMapFloor->get());
+    xml.setAttribute(HeatMapCeiling->paramID, (double)HeatMapCeiling->get());
+    xml.setAttribute(SpectrogramFftSize->paramID, SpectrogramFftSize->getIndex());
+    xml.setAttribute(SpectrogramWindow->paramID, SpectrogramWindow->getIndex());
+    xml.setAttribute(SpectrogramHop->paramID, SpectrogramHop->getIndex());
+    xml.setAttribute(SpectrogramMultiResolution->paramID, SpectrogramMultiResolution->get());
     for (auto& params : entryParams) {
         params.saveParameters(xml);
     }
 }
 void AllParams::loadParameters(juce::XmlElement& xml) {
+    *RecSeconds = (float)xml.getDoubleAttribute(RecSeconds->paramID, 4.0);
+    *RecToDisk = xml.getBoolAttribute(RecToDisk->paramID, false);
+    *RecTrigger = xml.getIntAttribute(RecTrigger->paramID, 0);
+    *TriggerLevel = (float)xml.getDoubleAttribute(TriggerLevel->paramID, -120.0);
+    *PreRollSec = (float)xml.getDoubleAttribute(PreRollSec->paramID, 0.1);
+    *FilterMode = xml.getIntAttribute(FilterMode->paramID, 0);
+    // states saved before it existed were designed with FilterN
+    *FilterAuto = xml.getBoolAttribute(FilterAuto->paramID, false);
     *FilterN = xml.getIntAttribute(FilterN->paramID, 100);
+    *FilterTransition = (float)xml.getDoubleAttribute(FilterTransition->paramID, 0.5);
+    *FilterAttenuation = (float)xml.getDoubleAttribute(FilterAttenuation->paramID, 60.0);
+    *FilterCrossfadeMs = (float)xml.getDoubleAttribute(FilterCrossfadeMs->paramID, 40.0);
+    *HeatMapColours = xml.getIntAttribute(HeatMapColours->paramID, 0);
+    *HeatMapChannel = xml.getIntAttribute(HeatMapChannel->paramID, 0);
+    *HeatMapFloor = (float)xml.getDoubleAttribute(HeatMapFloor->paramID, -100.0);
+    *HeatMapCeiling = (float)xml.getDoubleAttribute(HeatMapCeiling->paramID, 0.0);
+    *SpectrogramFftSize = xml.getIntAttribute(SpectrogramFftSize->paramID, 4);
+    *SpectrogramWindow = xml.getIntAttribute(SpectrogramWindow->paramID, 0);
+    *SpectrogramHop = xml.getIntAttribute(SpectrogramHop->paramID, 0);
+    *SpectrogramMultiResolution = xml.getBoolAttribute(SpectrogramMultiResolution->paramID, false);
     for (auto& params : entryParams) {
         params.loadParameters(xml);
     }
@@ -4,6 +4,8 @@
 
 namespace {
 const int NUM_ENTRIES = 4;
+// the longest take, which bounds every parameter in seconds of a take
+const float MAX_TAKE_SECONDS = 600.0f;
 }  // namespace
 
 //==============================================================================
@@ -37,7 +39,25 @@ public:
 //==============================================================================
 class AllParams : public ParametersBase {
 public:
+    juce::AudioParameterFloat* RecSeconds;
+    juce::AudioParameterBool* RecToDisk;
+    juce::AudioParameterChoice* RecTrigger;
+    juce::AudioParameterFloat* TriggerLevel;
+    juce::AudioParameterFloat* PreRollSec;
+    juce::AudioParameterChoice* FilterMode;
+    juce::AudioParameterBool* FilterAuto;
     juce::AudioParameterInt* FilterN;
+    juce::AudioParameterFloat* FilterTransition;
+    juce::AudioParameterFloat* FilterAttenuation;
+    juce::AudioParameterFloat* FilterCrossfadeMs;
+    juce::AudioParameterChoice* HeatMapColours;
+    juce::AudioParameterChoice* HeatMapChannel;
+    juce::AudioParameterFloat* HeatMapFloor;
+    juce::AudioParameterFloat* HeatMapCeiling;
+    juce::AudioParameterChoice* SpectrogramFftSize;
+    juce::AudioParameterChoice* SpectrogramWindow;
+    juce::AudioParameterChoice* SpectrogramHop;
+    juce::AudioParameterBool* SpectrogramMultiResolution;
     std::array<EntryParams, NUM_ENTRIES> entryParams;
 
     AllParams();
@@ -0,0 +1,556 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "Convolver.h"
+#include "FilterDesign.h"
+#include "IirFilter.h"
+#include "LockFreeQueue.h"
+#include "RecordingSource.h"
+
+//==============================================================================
+// Equal-power crossfade gains cos/sin(θ), advanced by rotation instead of calling std::sin per sample.
+class EqualPowerFade {
+public:
+    void start(int numSamples) {
+        length = std::max(1, numSamples);
+        position = 0;
+    }
+    void finish() { position = length; }
+    bool isFading() const { return position < length; }
+    // output = from * cos(θ) + to * sin(θ) for the rest of the fade; returns the number of samples mixed
+    int mix(const float *fromL,
+            const float *fromR,
+            const float *toL,
+            const float *toR,
+            float *outputL,
+            float *outputR,
+            int numSamples) {
+        auto delta = juce::MathConstants<double>::halfPi / length;
+        auto angle = delta * position;
+        double c = std::cos(angle), s = std::sin(angle);
+        double cd = std::cos(delta), sd = std::sin(delta);
+        auto size = std::min(numSamples, length - position);
+        for (int i = 0; i < size; i++) {
+            outputL[i] = (float)(fromL[i] * c + toL[i] * s);
+            outputR[i] = (float)(fromR[i] * c + toR[i] * s);
+            auto nextC = c * cd - s * sd;
+            s = s * cd + c * sd;
+            c = nextC;
+        }
+        position += size;
+        return size;
+    }
+
+private:
+    int length = 1;
+    int position = 1;
+};
+
+//==============================================================================
+// Hands immutable objects (kernels, renders) over to the audio thread without locks, and keeps the previous one while
+// it is crossfaded out. Objects may be shared (e.g. with a design cache), and the audio thread only moves references
+// around: it never allocates objects nor releases the last reference to one.
+template <typename T>
+class CrossfadeSlot {
+public:
+    using Ptr = std::shared_ptr<const T>;
+
+    CrossfadeSlot(){};
+    ~CrossfadeSlot(){};
+    CrossfadeSlot(const CrossfadeSlot &) = delete;
+
+    void setCrossfadeLength(int numSamples) { crossfadeLength = std::max(1, numSamples); }
+    // any non-audio thread; producers are serialised so that the queue keeps a single producer
+    void set(Ptr item) {
+        std::lock_guard<std::mutex> lock(producerMutex);
+        releaseRetired();
+        incoming.push(std::move(item));
+    }
+    // any non-audio thread: releases the objects the audio thread has let go of
+    void collectGarbage() {
+        std::lock_guard<std::mutex> lock(producerMutex);
+        releaseRetired();
+    }
+
+    // audio thread
+    const T *getActive() const { return active.get(); }
+    // audio thread: the previous object while crossfading
+    const T *getFading() const { return fading.get(); }
+    // audio thread: takes the newest object, crossfading from the active one if `crossfade`.
+    // a new object waits for the current crossfade to finish; intermediate ones are skipped.
+    void update(bool crossfade) {
+        if (fading != nullptr) {
+            return;
+        }
+        Ptr newest;
+        Ptr item;
+        // a retired object must never be released here, so stop taking new ones while the garbage is not collected
+        while (retired.getFreeSpace() > 2 && incoming.pop(item)) {
+            retire(newest);
+            newest = std::move(item);
+        }
+        if (newest == nullptr) {
+            return;
+        }
+        if (crossfade && active != nullptr) {
+            fading = std::move(active);
+            fade.start(crossfadeLength.load(std::memory_order_relaxed));
+        } else {
+            retire(active);
+        }
+        active = std::move(newest);
+    }
+    // audio thread: mixes the outputs of the fading and the active object; returns the number of samples mixed
+    int mix(const float *fadingL,
+            const float *fadingR,
+            const float *activeL,
+            const float *activeR,
+            float *outputL,
+            float *outputR,
+            int numSamples) {
+        auto size = fade.mix(fadingL, fadingR, activeL, activeR, outputL, outputR, numSamples);
+        if (!fade.isFading()) {
+            finishCrossfade();
+        }
+        return size;
+    }
+    // audio thread
+    void finishCrossfade() {
+        retire(fading);
+        fade.finish();
+    }
+
+private:
+    Ptr active;
+    Ptr fading;
+    std::atomic<int> crossfadeLength{2048};
+    EqualPowerFade fade;
+
+    std::mutex producerMutex;
+    LockFreeQueue<Ptr, 32> incoming;
+    LockFreeQueue<Ptr, 64> retired;
+
+    void releaseRetired() {
+        Ptr item;
+        while (retired.pop(item)) {
+            item.reset();
+        }
+    }
+    void retire(Ptr &item) {
+        if (item != nullptr) {
+            retired.push(std::move(item));
+            item = nullptr;
+        }
+    }
+};
+
+//==============================================================================
+// Filters a recorded stereo source block by block while it is being played.
+// The source is known in advance, so it is convolved one internal block ahead of the playing position and the
+// output has no latency. A kernel that arrives during playback is crossfaded in with equal power over
+// `crossfadeLength` samples.
+class PlaybackFilter {
+public:
+    PlaybackFilter(int blockSize, int maxKernelSize)
+        : blockSize(blockSize),
+          convolverL(blockSize, maxKernelSize),
+          convolverR(blockSize, maxKernelSize),
+          blockL(blockSize),
+          blockR(blockSize),
+          fadingL(blockSize),
+          fadingR(blockSize) {}
+    ~PlaybackFilter(){};
+    PlaybackFilter(const PlaybackFilter &) = delete;
+
+    int getMaxKernelSize() const { return convolverL.getMaxKernelSize(); }
+    void setCrossfadeLength(int numSamples) { kernels.setCrossfadeLength(numSamples); }
+
+    // any non-audio thread
+    void setKernel(std::shared_ptr<const ConvolutionKernel> kernel) {
+        jassert(kernel->getBlockSize() == blockSize);
+        jassert(kernel->getSize() <= getMaxKernelSize());
+        kernels.set(std::move(kernel));
+    }
+    // any non-audio thread
+    void collectGarbage() { kernels.collectGarbage(); }
+
+    // audio thread: starts filtering the source from `position`, seeding the history with the preceding samples
+    void start(const RecordingSource &newSource, int position) {
+        source = &newSource;
+        // nothing has been played yet, so the newest kernel is used as is
+        kernels.finishCrossfade();
+        kernels.update(false);
+        convolverL.reset();
+        convolverR.reset();
+        int start = position / blockSize * blockSize;
+        for (int pos = std::max(0, start - getMaxKernelSize()); pos < start; pos += blockSize) {
+            readSource(pos, blockL.data(), blockR.data());
+            convolverL.pushBlock(blockL.data());
+            convolverR.pushBlock(blockR.data());
+        }
+        sourcePosition = start;
+        renderNextBlock();
+        outputIndex = position - start;
+    }
+    // audio thread: adds the filtered source to the output
+    void process(float *outputL, float *outputR, int numSamples) {
+        int done = 0;
+        while (done < numSamples) {
+            if (outputIndex == blockSize) {
+                renderNextBlock();
+            }
+            auto size = std::min(numSamples - done, blockSize - outputIndex);
+            juce::FloatVectorOperations::add(outputL + done, blockL.data() + outputIndex, size);
+            juce::FloatVectorOperations::add(outputR + done, blockR.data() + outputIndex, size);
+            outputIndex += size;
+            done += size;
+        }
+    }
+
+private:
+    int blockSize;
+    Convolver convolverL;
+    Convolver convolverR;
+    std::vector<float> blockL;
+    std::vector<float> blockR;
+    std::vector<float> fadingL;
+    std::vector<float> fadingR;
+
+    const RecordingSource *source = nullptr;
+    int sourcePosition = 0;
+    int outputIndex = 0;
+
+    CrossfadeSlot<ConvolutionKernel> kernels;
+
+    void readSource(int pos, float *destinationL, float *destinationR) {
+        source->read(pos, destinationL, destinationR, blockSize);
+    }
+    void renderNextBlock() {
+        kernels.update(true);
+        readSource(sourcePosition, blockL.data(), blockR.data());
+        convolverL.pushBlock(blockL.data());
+        convolverR.pushBlock(blockR.data());
+        if (auto *active = kernels.getActive()) {
+            convolverL.convolve(*active, blockL.data());
+            convolverR.convolve(*active, blockR.data());
+        }
+        if (auto *fading = kernels.getFading()) {
+            // the input history is shared, so the old kernel only costs the spectral products and an inverse FFT
+            convolverL.convolve(*fading, fadingL.data());
+            convolverR.convolve(*fading, fadingR.data());
+            kernels.mix(
+                fadingL.data(), fadingR.data(), blockL.data(), blockR.data(), blockL.data(), blockR.data(), blockSize);
+        }
+        sourcePosition += blockSize;
+        outputIndex = 0;
+    }
+};
+
+//==============================================================================
+// A source filtered forward-backward with an IIR filter from `start` to its end, rendered part by part so that it can
+// be played as soon as the first part is ready.
+// The forward pass runs on continuously. The backward pass of each part starts from silence `margin` samples after
+// it, where the impulse response has decayed below what a float can hold, so the parts join up like a render of the
+// whole source.
+class FilteredRender {
+public:
+    // the request it was designed for (see RenderedPlayback::start())
+    const int generation;
+    const int start;
+
+    FilteredRender(std::shared_ptr<const RecordingSource> newSource, const IirSpec &spec, int start, int generation)
+        : generation(generation),
+          start(start),
+          source(std::move(newSource)),
+          cascade(spec),
+          state(cascade.createState()),
+          margin(cascade.getDecayLength(MARGIN_ATTENUATION)),
+          partSize(std::max((int)MIN_PART_SIZE, margin)) {
+        auto length = std::max(0, source->getNumSamples() - start);
+        dataL.resize(length);
+        dataR.resize(length);
+        scratchL.resize(partSize + margin);
+        scratchR.resize(partSize + margin);
+    }
+    ~FilteredRender(){};
+    FilteredRender(const FilteredRender &) = delete;
+
+    // any thread: the end of the rendered part
+    int getEnd() const { return start + numRendered.load(std::memory_order_acquire); }
+    bool isComplete() const { return numRendered.load(std::memory_order_acquire) == (int)dataL.size(); }
+    // any thread, below getEnd()
+    const float *getL(int position) const { return dataL.data() + position - start; }
+    const float *getR(int position) const { return dataR.data() + position - start; }
+
+    // the rendering thread: renders the next part; false once the render is complete
+    bool renderNext() {
+        auto length = (int)dataL.size();
+        auto rendered = numRendered.load(std::memory_order_relaxed);
+        if (rendered == 0 && forwardEnd == 0) {
+            // the forward pass settles on the samples before the start
+            auto from = std::max(0, start - margin);
+            for (int pos = from; pos < start; pos += (int)scratchL.size()) {
+                auto size = std::min((int)scratchL.size(), start - pos);
+                source->read(pos, scratchL.data(), scratchR.data(), size);
+                cascade.processForward(state, scratchL.data(), scratchR.data(), size);
+            }
+        }
+        if (rendered >= length) {
+            return false;
+        }
+        auto end = std::min(length, rendered + partSize);
+        auto forwardTo = std::min(length, end + margin);
+        // beyond the rendered part, so the forward pass can write in place
+        if (forwardEnd < forwardTo) {
+            source->read(start + forwardEnd, &dataL[forwardEnd], &dataR[forwardEnd], forwardTo - forwardEnd);
+            cascade.processForward(state, &dataL[forwardEnd], &dataR[forwardEnd], forwardTo - forwardEnd);
+            forwardEnd = forwardTo;
+        }
+        // the margin keeps the output of the forward pass for the next part
+        auto size = forwardTo - rendered;
+        std::copy(&dataL[rendered], &dataL[rendered] + size, scratchL.data());
+        std::copy(&dataR[rendered], &dataR[rendered] + size, scratchR.data());
+        cascade.processBackward(scratchL.data(), scratchR.data(), size);
+        std::copy(scratchL.data(), scratchL.data() + end - rendered, &dataL[rendered]);
+        std::copy(scratchR.data(), scratchR.data() + end - rendered, &dataR[rendered]);
+        numRendered.store(end, std::memory_order_release);
+        return end < length;
+    }
+
+private:
+    // below the resolution of a float
+    static constexpr double MARGIN_ATTENUATION = 150.0;
+    enum { MIN_PART_SIZE = 16384 };
+
+    std::shared_ptr<const RecordingSource> source;
+    BiquadCascade cascade;
+    BiquadCascade::State state;
+    int margin;
+    int partSize;
+    // written ahead of numRendered by the rendering thread only
+    std::vector<float> dataL;
+    std::vector<float> dataR;
+    std::vector<float> scratchL;
+    std::vector<float> scratchR;
+    int forwardEnd = 0;
+    std::atomic<int> numRendered{0};
+};
+
+//==============================================================================
+// Plays filtered copies of the source (e.g. rendered forward-backward with an IIR filter, which cannot be done block
+// by block) instead of filtering it while playing. Renders are handed over and crossfaded like PlaybackFilter's
+// kernels, and are played while they are still being rendered.
+class RenderedPlayback {
+public:
+    RenderedPlayback(){};
+    ~RenderedPlayback(){};
+    RenderedPlayback(const RenderedPlayback &) = delete;
+
+    void setCrossfadeLength(int numSamples) { renders.setCrossfadeLength(numSamples); }
+    // any non-audio thread
+    void setRender(std::shared_ptr<const FilteredRender> render) { renders.set(std::move(render)); }
+    // any non-audio thread: renders are large, so they are released as soon as they are no longer played
+    void collectGarbage() { renders.collectGarbage(); }
+
+    // audio thread: plays from `newPosition` once the render of request `generation` (or of a later one) arrives
+    void start(int newPosition, int generation) {
+        renders.finishCrossfade();
+        renders.update(false);
+        position = newPosition;
+        requiredGeneration = generation;
+    }
+    // audio thread: adds the render to the output and returns the number of samples played, which is less than
+    // `numSamples` while the part to play has not been rendered yet
+    int process(float *outputL, float *outputR, int numSamples) {
+        int done = 0;
+        while (done < numSamples) {
+            // a render of a previous play is replaced, not crossfaded from
+            renders.update(isCurrent(renders.getActive()));
+            auto *active = renders.getActive();
+            if (!isCurrent(active)) {
+                return done;
+            }
+            jassert(active->start <= position);
+            auto available = active->getEnd() - position;
+            if (available <= 0) {
+                if (!active->isComplete()) {
+                    return done;
+                }
+                // the end of the source
+                position += numSamples - done;
+                return numSamples;
+            }
+            auto size = std::min({numSamples - done, available, (int)mixL.size()});
+            int mixed = 0;
+            if (auto *fading = renders.getFading()) {
+                // what is left of the previous render, if it was not rendered to the end
+                auto fadingSize = juce::jlimit(0, size, fading->getEnd() - position);
+                std::fill(mixL.begin(), mixL.end(), 0.0f);
+                std::fill(mixR.begin(), mixR.end(), 0.0f);
+                if (fadingSize > 0) {
+                    std::copy(fading->getL(position), fading->getL(position) + fadingSize, mixL.begin());
+                    std::copy(fading->getR(position), fading->getR(position) + fadingSize, mixR.begin());
+                }
+                mixed = renders.mix(mixL.data(),
+                                    mixR.data(),
+                                    active->getL(position),
+                                    active->getR(position),
+                                    mixL.data(),
+                                    mixR.data(),
+                                    size);
+                juce::FloatVectorOperations::add(outputL + done, mixL.data(), mixed);
+                juce::FloatVectorOperations::add(outputR + done, mixR.data(), mixed);
+            }
+            juce::FloatVectorOperations::add(outputL + done + mixed, active->getL(position) + mixed, size - mixed);
+            juce::FloatVectorOperations::add(outputR + done + mixed, active->getR(position) + mixed, size - mixed);
+            position += size;
+            done += size;
+        }
+        return done;
+    }
+
+private:
+    CrossfadeSlot<FilteredRender> renders;
+    int position = 0;
+    int requiredGeneration = 0;
+    std::array<float, 256> mixL{};
+    std::array<float, 256> mixR{};
+
+    bool isCurrent(const FilteredRender *render) const {
+        return render != nullptr && render->generation >= requiredGeneration;
+    }
+};
+
+//==============================================================================
+enum class FilterType { FIR, IIR };
+
+//==============================================================================
+struct FilterSpec {
+    int entryIndex = 0;
+    FilterType type = FilterType::FIR;
+    float lowFreq = 20;
+    float highFreq = 20000;
+    // fixed FIR order, or 0 for the smallest order that meets `transitionRatio` and `attenuation` (always for IIR)
+    int n = 0;
+    FilterWindow window = FilterWindow::Blackman;
+    float kaiserBeta = 8.6f;
+    float transitionRatio = 0.5f;
+    float attenuation = 60.0f;
+    // IIR: where the render starts, i.e. where it is played from
+    int position = 0;
+};
+
+//==============================================================================
+// either of them; a render has only been set up, and is rendered by the designer
+struct DesignedFilter {
+    std::shared_ptr<const ConvolutionKernel> kernel;
+    std::shared_ptr<FilteredRender> render;
+};
+
+//==============================================================================
+// Designs filters on a background thread and hands them to a PlaybackFilter (kernels) or a RenderedPlayback
+// (renders). Only the latest request matters, so requests made while a design is in progress replace each other.
+// A render is handed over once its first part is rendered, and rendered to the end before the next request is taken.
+class FilterDesigner : private juce::Thread {
+public:
+    // designs the filter for request number `generation`
+    using DesignFunction = std::function<DesignedFilter(const FilterSpec &, int generation)>;
+
+    FilterDesigner(PlaybackFilter &playbackFilter, RenderedPlayback &renderedPlayback, DesignFunction design)
+        : juce::Thread("Filter Designer"),
+          playbackFilter(playbackFilter),
+          renderedPlayback(renderedPlayback),
+          design(std::move(design)) {
+        startThread();
+    }
+    ~FilterDesigner() override {
+        signalThreadShouldExit();
+        notify();
+        stopThread(1000);
+    }
+    FilterDesigner(const FilterDesigner &) = delete;
+
+    // designs in the background; returns the number of the request
+    int request(const FilterSpec &spec) {
+        int requestGeneration;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending = spec;
+            hasPending = true;
+            requestGeneration = ++generation;
+        }
+        notify();
+        return requestGeneration;
+    }
+    // designs a kernel on the calling thread, discarding any request in progress
+    void designNow(const FilterSpec &spec) {
+        int requestGeneration;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            hasPending = false;
+            requestGeneration = ++generation;
+        }
+        auto designed = design(spec, requestGeneration);
+        jassert(designed.render == nullptr);
+        std::lock_guard<std::mutex> lock(mutex);
+        handOver(std::move(designed));
+    }
+
+private:
+    PlaybackFilter &playbackFilter;
+    RenderedPlayback &renderedPlayback;
+    DesignFunction design;
+    std::mutex mutex;
+    FilterSpec pending;
+    bool hasPending = false;
+    int generation = 0;
+    // designer thread: handed over and not rendered to the end yet
+    std::shared_ptr<FilteredRender> rendering;
+
+    void run() override {
+        while (!threadShouldExit()) {
+            // part by part, so that the thread can stop in between
+            if (rendering != nullptr) {
+                if (!rendering->renderNext()) {
+                    rendering = nullptr;
+                }
+                continue;
+            }
+            FilterSpec spec;
+            int requestGeneration;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!hasPending) {
+                    requestGeneration = -1;
+                } else {
+                    spec = pending;
+                    hasPending = false;
+                    requestGeneration = generation;
+                }
+            }
+            if (requestGeneration < 0) {
+                wait(-1);
+                continue;
+            }
+            auto designed = design(spec, requestGeneration);
+            auto render = designed.render;
+            if (render != nullptr && !render->renderNext()) {
+                render = nullptr;
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (requestGeneration == generation) {
+                handOver(std::move(designed));
+                rendering = std::move(render);
+            }
+        }
+    }
+    void handOver(DesignedFilter designed) {
+        if (designed.kernel != nullptr) {
+            playbackFilter.setKernel(std::move(designed.kernel));
+        }
+        if (designed.render != nullptr) {
+            renderedPlayback.setRender(std::move(designed.render));
+        }
+    }
+};
@@ -73,6 +73,8 @@ void SeedAudioProcessor::prepareToPlay(double sampleRate, int samplesPerBlock) {
     std::cout << "sampleRate: " << sampleRate << std::endl;
     std::cout << "totalNumInputChannels: " << getTotalNumInputChannels() << std::endl;
     std::cout << "totalNumOutputChannels: " << getTotalNumOutputChannels() << std::endl;
+    latestDataProvider.setSampleRate(sampleRate);
+    recorder.prepareToPlay(sampleRate, samplesPerBlock);
 }
 
 void SeedAudioProcessor::releaseResources() { std::cout << "releaseResources" << std::endl; }
@@ -108,7 +110,7 @@ void SeedAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::Mi
 
     keyboardState.processNextMidiBuffer(midiMessages, 0, numSamples, true);
     latestDataProvider.push(buffer);
-    recorder.push(buffer, getSampleRate());
+    recorder.push(buffer, getSampleRate(), midiMessages);
 
     midiMessages.clear();
 }
@@ -122,10 +124,18 @@ juce::AudioProcessorEditor* SeedAudioProcessor::createEditor() { return new Seed
 void SeedAudioProcessor::getStateInformation(juce::MemoryBlock& destData) {
     juce::XmlElement xml("SeedAnalyser");
     for (int i = 0; i < NUM_ENTRIES; i++) {
-        auto& entry = recorder.entries[i];
+        auto snapshot = recorder.getSnapshot(i);
+        auto& entry = *snapshot;
         allParams.entryParams[i].saveParameters(xml);
-        xml.setAttribute("E" + juce::String(i) + "_DATA_L", juce::Base64::toBase64(&entry.dataL, DATA_SIZE));
-        xml.setAttribute("E" + juce::String(i) + "_DATA_R", juce::Base64::toBase64(&entry.dataR, DATA_SIZE));
+        auto prefix = "E" + juce::String(i);
+        // a disk take can be far longer than a host should keep in a project, and its file is temporary: not saved
+        auto numSamples = entry.onDisk ? 0 : entry.getNumSamples();
+        std::vector<float> dataL(numSamples);
+        std::vector<float> dataR(numSamples);
+        entry.read(0, dataL.data(), dataR.data(), numSamples);
+        xml.setAttribute(prefix + "_SAMPLE_RATE", (double)entry.sampleRate);
+        xml.setAttribute(prefix + "_DATA_L", juce::Base64::toBase64(dataL.data(), sizeof(float) * numSamples));
+        xml.setAttribute(prefix + "_DATA_R", juce::Base64::toBase64(dataR.data(), sizeof(float) * numSamples));
     }
     copyXmlToBinary(xml, destData);
 }
@@ -133,12 +143,30 @@ void SeedAudioProcessor::setStateInformation(const void* data, int sizeInBytes)
     std::unique_ptr<juce::XmlElement> xml(getXmlFromBinary(data, sizeInBytes));
     if (xml && xml->hasTagName("SeedAnalyser")) {
         for (int i = 0; i < NUM_ENTRIES; i++) {
-            auto& entry = recorder.entries[i];
             allParams.entryParams[i].loadParameters(*xml);
-            MemoryOutputStream outL{entry.dataL, DATA_SIZE};
-            MemoryOutputStream outR{entry.dataR, DATA_SIZE};
-            juce::Base64::convertFromBase64(outL, xml->getStringAttribute("E" + juce::String(i) + "_DATA_L", ""));
-            juce::Base64::convertFromBase64(outR, xml->getStringAttribute("E" + juce::String(i) + "_DATA_R", ""));
+            auto prefix = "E" + juce::String(i);
+            juce::MemoryBlock blockL;
+            juce::MemoryBlock blockR;
+            {
+                MemoryOutputStream outL{blockL, false};
+                MemoryOutputStream outR{blockR, false};
+                juce::Base64::convertFromBase64(outL, xml->getStringAttribute(prefix + "_DATA_L", ""));
+                juce::Base64::convertFromBase64(outR, xml->getStringAttribute(prefix + "_DATA_R", ""));
+            }
+            // older states always hold 4 seconds at 48 kHz
+            auto sampleRate = (float)xml->getDoubleAttribute(prefix + "_SAMPLE_RATE", 48000.0);
+            auto numSamples = (int)(std::min(blockL.getSize(), blockR.getSize()) / sizeof(float));
+            auto* dataL = static_cast<const float*>(blockL.getData());
+            auto* dataR = static_cast<const float*>(blockR.getData());
+            std::vector<float> restoredL(dataL, dataL + numSamples);
+            std::vector<float> restoredR(dataR, dataR + numSamples);
+            // converted to the current rate once, rather than every time it is played
+            auto hostSampleRate = getSampleRate();
+            if (hostSampleRate > 0 && hostSampleRate != sampleRate &&
+                Resampler::convert(restoredL, restoredR, sampleRate, hostSampleRate)) {
+                sampleRate = hostSampleRate;
+            }
+            recorder.restoreEntry(i, sampleRate, std::move(restoredL), std::move(restoredR));
         }
     }
 }
@@ -2,7 +2,13 @@
 
 #include <JuceHeader.h>
 
+#include "ChunkPool.h"
+#include "DiskRecording.h"
+#include "LockFreeQueue.h"
 #include "Params.h"
+#include "PlaybackFilter.h"
+#include "Resampler.h"
+#include "Trigger.h"
 
 //==============================================================================
 class TimeConsumptionState {
@@ -41,244 +47,622 @@ public:
         float *destinationL;
         float *destinationR;
         int numSamples = 0;
-        bool ready = false;
+        uint64_t sequence = 0;
     };
-    enum { numSamples = 2048 };
-    std::vector<Consumer *> consumers{};
+    // must be a power of two
+    enum { capacity = 8192 };
 
     LatestDataProvider(){};
     ~LatestDataProvider(){};
-    void addConsumer(Consumer *c) {
-        std::lock_guard<std::mutex> lock(mtx);
-        jassert(c->numSamples <= numSamples);
-        consumers.push_back(c);
-    }
-    void removeConsumer(Consumer *c) {
-        std::lock_guard<std::mutex> lock(mtx);
-        consumers.erase(remove(consumers.begin(), consumers.end(), c), consumers.end());
-    }
+
+    // the rate of the pushed samples, set while the audio thread is not running
+    void setSampleRate(double newSampleRate) { sampleRate = (float)newSampleRate; }
+    float getSampleRate() const { return sampleRate.load(); }
+
+    // audio thread (single producer)
     void push(juce::AudioBuffer<float> &buffer) {
-        if (buffer.getNumChannels() <= 0) {
+        auto numChannels = buffer.getNumChannels();
+        if (numChannels <= 0) {
             return;
         }
-        std::lock_guard<std::mutex> lock(mtx);
-        auto *dataL = buffer.getReadPointer(0);
-        auto *dataR = buffer.getReadPointer(1);
-        for (auto i = 0; i < buffer.getNumSamples(); ++i) {
-            fifoL[fifoIndex] = dataL[i];
-            fifoR[fifoIndex] = dataR[i];
-            fifoIndex++;
-            for (auto *consumer : consumers) {
-                if (!consumer->ready && fifoIndex >= consumer->numSamples) {
-                    memcpy(consumer->destinationL,
-                           fifoL + fifoIndex - consumer->numSamples,
-                           sizeof(float) * consumer->numSamples);
-                    memcpy(consumer->destinationR,
-                           fifoR + fifoIndex - consumer->numSamples,
-                           sizeof(float) * consumer->numSamples);
-                    consumer->ready = true;
-                }
-            }
-            if (fifoIndex >= numSamples) {
-                fifoIndex = 0;
-            }
+        auto numSamples = buffer.getNumSamples();
+        auto skip = std::max(0, numSamples - (int)capacity);
+        auto *dataL = buffer.getReadPointer(0, skip);
+        auto *dataR = buffer.getReadPointer(std::min(1, numChannels - 1), skip);
+        auto end = writePosition.load(std::memory_order_relaxed) + skip;
+        // announced before writing, so that readers of the overwritten region can tell
+        writeStart.store(end + numSamples - skip, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        write(fifoL, dataL, end, numSamples - skip);
+        write(fifoR, dataR, end, numSamples - skip);
+        writePosition.store(end + numSamples - skip, std::memory_order_release);
+    }
+    uint64_t getWritePosition() const { return writePosition.load(std::memory_order_acquire); }
+
+    // any thread: copies the latest `numSamples` samples and returns the sequence number (total number of samples
+    // pushed so far) of the end of the copied window. Returns false if not enough samples have been pushed yet or the
+    // window was overwritten while copying.
+    bool copyLatest(float *destinationL, float *destinationR, int numSamples, uint64_t &sequence) const {
+        jassert(numSamples <= capacity);
+        auto end = writePosition.load(std::memory_order_acquire);
+        if (end < (uint64_t)numSamples) {
+            return false;
+        }
+        auto begin = end - numSamples;
+        read(fifoL, destinationL, begin, numSamples);
+        read(fifoR, destinationR, begin, numSamples);
+        // the block being written (not only the written ones) may have overwritten the window
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (writeStart.load(std::memory_order_relaxed) - begin > capacity) {
+            return false;
+        }
+        sequence = end;
+        return true;
+    }
+    // fills the consumer only when new samples have arrived since its last read
+    bool read(Consumer &c) const {
+        if (getWritePosition() == c.sequence) {
+            return false;
         }
+        return copyLatest(c.destinationL, c.destinationR, c.numSamples, c.sequence);
     }
 
 private:
-    float fifoL[numSamples]{};
-    float fifoR[numSamples]{};
-    int fifoIndex = 0;
-    std::mutex mtx;
+    float fifoL[capacity]{};
+    float fifoR[capacity]{};
+    std::atomic<float> sampleRate{48000};
+    std::atomic<uint64_t> writePosition{0};
+    // the end of the block being written (seqlock)
+    std::atomic<uint64_t> writeStart{0};
+
+    static void write(float *fifo, const float *source, uint64_t position, int numSamples) {
+        auto start = (int)(position & (capacity - 1));
+        auto size1 = std::min(numSamples, (int)capacity - start);
+        memcpy(fifo + start, source, sizeof(float) * size1);
+        memcpy(fifo, source + size1, sizeof(float) * (numSamples - size1));
+    }
+    static void read(const float *fifo, float *destination, uint64_t position, int numSamples) {
+        auto start = (int)(position & (capacity - 1));
+        auto size1 = std::min(numSamples, (int)capacity - start);
+        memcpy(destination, fifo + start, sizeof(float) * size1);
+        memcpy(destination + size1, fifo, sizeof(float) * (numSamples - size1));
+    }
 };
 
 //==============================================================================
 
 namespace {
-constexpr int MAX_REC_SECONDS = 4;
-constexpr int MAX_REC_SAMPLES = 48000 * MAX_REC_SECONDS;
-constexpr int DATA_SIZE = sizeof(float) * MAX_REC_SAMPLES;
+constexpr int CONVOLUTION_BLOCK_SIZE = 256;
+constexpr int MAX_FILTER_SIZE = 4096;
+constexpr int MAX_IIR_ORDER = 8;
+// longer takes (about 43 s at 48 kHz) are filtered with FIR: a render is a copy of the take, up to 16 MB
+constexpr int MAX_IIR_RENDER_SAMPLES = 1 << 21;
+constexpr float MIN_FILTER_FREQ = 20.0f;
+constexpr float MAX_FILTER_FREQ = 20000.0f;
 }  // namespace
-class Recorder {
+
+//==============================================================================
+// A finished take of an entry as published by the Recorder. Immutable: the storage is never written again, so
+// readers can keep a consistent view for as long as they hold it, without copying samples. Each publication gets a
+// new generation, which tells whether anything derived from a snapshot is stale.
+class EntrySnapshot : public RecordingSource {
 public:
-    class Entry {
-    public:
-        Entry(const Entry &) = delete;
+    const uint64_t generation;
+    const float sampleRate;
+    // streamed to a temporary file rather than kept in memory
+    const bool onDisk;
+
+    EntrySnapshot(uint64_t generation, float sampleRate, bool onDisk, std::shared_ptr<const RecordingSource> storage)
+        : generation(generation), sampleRate(sampleRate), onDisk(onDisk), storage(std::move(storage)){};
+    ~EntrySnapshot() override{};
+    EntrySnapshot(const EntrySnapshot &) = delete;
+
+    float getLengthInSec() const { return getNumSamples() / sampleRate; }
+    int getNumSamples() const override { return storage->getNumSamples(); }
+    void read(int start, float *destinationL, float *destinationR, int size) const override {
+        storage->read(start, destinationL, destinationR, size);
+    }
+    void addTo(int start, float *outputL, float *outputR, int size) const override {
+        storage->addTo(start, outputL, outputR, size);
+    }
+
+private:
+    std::shared_ptr<const RecordingSource> storage;
+};
+
+//==============================================================================
+// Records and plays the entries. The audio thread runs the transport; everything else (starting a take, finishing it,
+// designing filters) happens on the message thread, including finishing a take when no editor is open.
+class Recorder : private juce::Timer {
+public:
+    // A take while it is being recorded. The storage only grows (getNumSamples() is how far it has been written) and
+    // is `length` samples long if it is recorded to the end, in which case its snapshot gets the same generation.
+    struct LiveTake {
+        uint64_t generation = 0;
         float sampleRate = 48000;
-        float dataL[MAX_REC_SAMPLES]{};
-        float dataR[MAX_REC_SAMPLES]{};
+        int length = 0;
+        std::shared_ptr<const RecordingSource> storage;
     };
 
-    std::array<Entry, NUM_ENTRIES> entries{};
-    int getCurrentEntryIndex() {
-        std::lock_guard<std::mutex> lock(mtx);
-        return currentEntryIndex;
-    }
-    void setCurrentEntryIndex(int index) {
-        std::lock_guard<std::mutex> lock(mtx);
-        currentEntryIndex = index;
+    // non-audio thread: the latest snapshot of an entry (never nullptr)
+    std::shared_ptr<const EntrySnapshot> getSnapshot(int entryIndex) const {
+        return std::atomic_load(&snapshots[entryIndex]);
     }
-    bool isPlaying() {
-        std::lock_guard<std::mutex> lock(mtx);
-        return mode == Mode::PLAYING;
+    // GUI thread: false unless the entry is being recorded (or armed) and not yet finished
+    bool getLiveTake(int entryIndex, LiveTake &take) const {
+        if (recordingEntryIndex != entryIndex) {
+            return false;
+        }
+        take = liveTake;
+        return true;
     }
+    int getCurrentEntryIndex() { return currentEntryIndex.load(); }
+    void setCurrentEntryIndex(int index) { currentEntryIndex = index; }
+    bool isPlaying() { return mode.load() == Mode::PLAYING; }
+    // waiting for the trigger of a recording
+    bool isArmed() { return mode.load() == Mode::ARMED; }
     bool canOperate() {
-        std::lock_guard<std::mutex> lock(mtx);
-        return mode == Mode::WAITING;
+        // the order matters: push() applies a command before it stops counting it, so once no command is pending the
+        // mode reflects all of them. Loading the mode first could see WAITING just before a RECORD or PLAY is applied.
+        if (numPendingCommands.load() != 0) {
+            return false;
+        }
+        return mode.load() == Mode::WAITING;
     }
-    void changeIndex(int index) {
-        std::lock_guard<std::mutex> lock(mtx);
-        currentEntryIndex = index;
-        filterEnabled = false;  // TODO: ロジックが微妙
+    // whether the entry can be played with an IIR filter: it is rendered in memory, so disk and long takes cannot
+    bool canRenderIir(int entryIndex) const {
+        auto snapshot = getSnapshot(entryIndex);
+        return !snapshot->onDisk && snapshot->getNumSamples() <= MAX_IIR_RENDER_SAMPLES;
     }
+    void changeIndex(int index) { currentEntryIndex = index; }
     float getPlayingPositionInSec() {
-        std::lock_guard<std::mutex> lock(mtx);
-        if (mode != Mode::PLAYING) {
+        if (mode.load() != Mode::PLAYING) {
             return -1;
         }
-        return (float)cursor / entries[currentEntryIndex].sampleRate;
+        return (float)cursor.load() / entries[activeEntryIndex.load()].sampleRate;
+    }
+    void play(float fromSec, bool filterEnabled, FilterSpec filter) {
+        if (!canOperate()) {
+            return;
+        }
+        // the filter is designed from the snapshot
+        updateEntries();
+        int entryIndex = currentEntryIndex.load();
+        auto sampleRate = entries[entryIndex].sampleRate;
+        int from = fromSec * sampleRate;
+        if (filter.type == FilterType::IIR && !canRenderIir(entryIndex)) {
+            filter.type = FilterType::FIR;
+        }
+        playingFilterType = filter.type;
+        auto targetRate = hostSampleRate.load();
+        if (sampleRate != targetRate && !resampler.isPreparedFor(sampleRate, targetRate)) {
+            resampler.prepare(sampleRate, targetRate);
+        }
+        Command command{CommandType::PLAY, entryIndex, from, filterEnabled, filter.type};
+        if (filterEnabled && filter.type == FilterType::IIR) {
+            // the audio thread starts playing as soon as the first part is rendered
+            filter.entryIndex = entryIndex;
+            filter.position = from;
+            command.renderGeneration = designer.request(filter);
+        } else if (filterEnabled) {
+            filter.entryIndex = entryIndex;
+            designer.designNow(filter);
+        }
+        sendCommand(command);
+    }
+    // designed in the background and crossfaded in while playing
+    void updateFilter(FilterSpec filter) {
+        if (mode.load() != Mode::PLAYING) {
+            return;
+        }
+        filter.entryIndex = activeEntryIndex.load();
+        // the type cannot change until the next play
+        filter.type = playingFilterType;
+        filter.position = cursor.load();
+        designer.request(filter);
+    }
+    // the kernel that would be designed for `filter` (e.g. to show the automatically chosen order)
+    KernelSpec resolveFilter(const FilterSpec &filter) {
+        auto sampleRate = getSnapshot(filter.entryIndex)->sampleRate;
+        float lowFreq, highFreq;
+        getOpenEdges(filter, sampleRate, lowFreq, highFreq);
+        if (filter.n > 0) {
+            return KernelSpec{filter.n, lowFreq, highFreq, sampleRate, filter.window, filter.kaiserBeta};
+        }
+        return KernelDesigner::minimalSpec(
+            lowFreq, highFreq, sampleRate, filter.transitionRatio, filter.attenuation, MAX_FILTER_SIZE - 1);
+    }
+    // the IIR filter that would be rendered for `filter`
+    IirSpec resolveIirFilter(const FilterSpec &filter) {
+        auto sampleRate = getSnapshot(filter.entryIndex)->sampleRate;
+        float lowFreq, highFreq;
+        getOpenEdges(filter, sampleRate, lowFreq, highFreq);
+        auto order = BiquadCascade::minimalOrder(
+            lowFreq, highFreq, sampleRate, filter.transitionRatio, filter.attenuation, MAX_IIR_ORDER);
+        return IirSpec{order, lowFreq, highFreq, sampleRate};
+    }
+    // the crossfade to a filter retuned while playing, in samples of the entry
+    void setCrossfadeLength(int numSamples) {
+        playbackFilter.setCrossfadeLength(numSamples);
+        renderedPlayback.setCrossfadeLength(numSamples);
+    }
+    void stop() { sendCommand(Command{CommandType::STOP}); }
+    // starts at `trigger`; `toDisk` streams the take to a temporary file instead of the heap, for long takes
+    void record(float maxSeconds, bool toDisk, TriggerSpec trigger) {
+        if (!canOperate()) {
+            return;
+        }
+        updateEntries();
+        int entryIndex = currentEntryIndex.load();
+        auto &entry = entries[entryIndex];
+        // the previous take is gone once it is overwritten
+        setEmpty(entryIndex);
+        // only kept while armed; the block that contains the trigger is written before the pre-roll is read
+        preRoll.prepare((int)(trigger.preRollSeconds * hostSampleRate.load()) + maxBlockSize);
+        // the pre-roll is part of the take
+        int maxSamples = (maxSeconds + trigger.preRollSeconds) * hostSampleRate.load();
+        auto disk = toDisk ? std::make_shared<DiskRecording>() : nullptr;
+        if (disk != nullptr && disk->start(hostSampleRate.load(), maxSamples)) {
+            entry.disk = disk.get();
+            entry.storage = std::move(disk);
+        } else {
+            auto memory = std::make_shared<ChunkedRecording>(pool);
+            // the chunks are reserved here so that the audio thread only takes them, and the take ends where they do
+            auto numChunks = pool.reserve(ChunkPool::numChunksFor(maxSamples));
+            entry.isCutShort = numChunks * ChunkPool::chunkSize < maxSamples;
+            maxSamples = std::min(maxSamples, numChunks * (int)ChunkPool::chunkSize);
+            memory->prepare(maxSamples);
+            entry.memory = memory.get();
+            entry.storage = std::move(memory);
+        }
+        recordingEntryIndex = entryIndex;
+        liveTake = LiveTake{++generation, hostSampleRate.load(), maxSamples, entry.storage};
+        Command command{CommandType::RECORD, entryIndex};
+        command.trigger = trigger;
+        sendCommand(command);
     }
-    void play(float fromSec, bool filterEnabled, int n, float lowFreq, float highFreq) {
-        std::lock_guard<std::mutex> lock(mtx);
-        if (mode != Mode::WAITING) {
+    // releases the memory (or the file) of the current entry
+    void clear() {
+        if (!canOperate()) {
             return;
         }
-        bool turnedOn = !this->filterEnabled && filterEnabled;
-        bool changed = filterN != n || filterLowFreq != lowFreq || filterHighFreq != highFreq;
-        this->filterEnabled = filterEnabled;
-        filterN = n;
-        filterLowFreq = lowFreq;
-        filterHighFreq = highFreq;
-        if (turnedOn || changed) {
-            DBG("begin calculateFilter");
-            calculateFilter();
-            DBG("end calculateFilter");
-        }
-        mode = Mode::PLAYING;
-        cursor = fromSec * entries[currentEntryIndex].sampleRate;
-    }
-    void stop() {
-        std::lock_guard<std::mutex> lock(mtx);
-        mode = Mode::WAITING;
-    }
-    void record() {
-        std::lock_guard<std::mutex> lock(mtx);
-        if (mode != Mode::WAITING) {
+        // the chunks come back as soon as no reader holds the previous snapshot
+        setEmpty(currentEntryIndex.load());
+        pool.trim();
+    }
+    // message thread: publishes a finished recording (closes and maps a disk take, frees unused chunks).
+    // called periodically, so that a take is saved with the state even if the editor is never opened
+    void finishRecording() {
+        if (!canOperate() || recordingEntryIndex < 0) {
             return;
         }
-        mode = Mode::RECORDING;
-        cursor = 0;
+        auto &entry = entries[recordingEntryIndex];
+        if (entry.disk != nullptr) {
+            entry.disk->finish();
+        }
+        // a take stopped early (or at another rate) is not what the live take promised
+        auto complete = entry.storage->getNumSamples() == liveTake.length && entry.sampleRate == liveTake.sampleRate;
+        publish(recordingEntryIndex, complete ? liveTake.generation : ++generation);
+        recordingEntryIndex = -1;
+        liveTake = LiveTake{};
+        preRoll.release();
+        pool.trim();
+    }
+    // frees chunks that are neither reserved nor held by a snapshot, e.g. after a reader has let go of an old one
+    void releaseUnusedMemory() {
+        if (!canOperate()) {
+            return;
+        }
+        pool.trim();
+    }
+    size_t getAllocatedBytes() { return pool.getAllocatedBytes(); }
+    // message thread: whether the take of the entry is shorter than requested because the memory ran out
+    bool isCutShort(int entryIndex) { return entries[entryIndex].isCutShort; }
+    // message thread: samples of a disk take written as silence because the disk could not keep up
+    int getNumDroppedSamples(int entryIndex) {
+        auto *disk = entries[entryIndex].disk;
+        return disk != nullptr ? disk->getNumDroppedSamples() : 0;
+    }
+    // any thread: replaces an entry with saved samples. The audio thread may be using the entry, so it is replaced
+    // on the message thread once nothing is being recorded or played.
+    void restoreEntry(int entryIndex, float sampleRate, std::vector<float> dataL, std::vector<float> dataR) {
+        {
+            std::lock_guard<std::mutex> lock(restoreMutex);
+            pendingRestores[entryIndex] =
+                std::make_unique<PendingRestore>(PendingRestore{sampleRate, std::move(dataL), std::move(dataR)});
+        }
+        if (juce::MessageManager::existsAndIsCurrentThread()) {
+            updateEntries();
+        }
     }
 
-    Recorder(){};
-    ~Recorder(){};
-    void push(juce::AudioBuffer<float> &buffer, float sampleRate) {
+    Recorder() {
+        for (int i = 0; i < NUM_ENTRIES; i++) {
+            setEmpty(i);
+        }
+        startTimerHz(20);
+    };
+    ~Recorder() override { stopTimer(); };
+    // while the audio thread is not running
+    void prepareToPlay(double sampleRate, int newMaxBlockSize) {
+        hostSampleRate.store((float)sampleRate);
+        maxBlockSize = newMaxBlockSize;
+    }
+    void push(juce::AudioBuffer<float> &buffer, float sampleRate, const juce::MidiBuffer &midi) {
+        // audio thread: never blocks
+        Command command;
+        while (commands.pop(command)) {
+            applyCommand(command);
+            numPendingCommands--;
+        }
         if (buffer.getNumChannels() <= 0) {
             return;
         }
-        std::lock_guard<std::mutex> lock(mtx);
         auto *readL = buffer.getReadPointer(0);
         auto *readR = buffer.getReadPointer(1);
         auto *writeL = buffer.getWritePointer(0);
         auto *writeR = buffer.getWritePointer(1);
-        if (entries.size() <= 0) {
+        hostSampleRate.store(sampleRate, std::memory_order_relaxed);
+        auto currentMode = mode.load(std::memory_order_relaxed);
+        if (currentMode == Mode::WAITING) {
             return;
         }
-        auto &entry = entries[currentEntryIndex];
-        if (mode == Mode::RECORDING) {
-            entry.sampleRate = sampleRate;
-            for (auto i = 0; i < buffer.getNumSamples(); ++i) {
-                if (MAX_REC_SAMPLES <= cursor) {
-                    mode = Mode::WAITING;
-                    cursor = 0;
-                }
-                if (mode == Mode::WAITING) {
-                    break;
+        auto &entry = entries[activeEntryIndex.load(std::memory_order_relaxed)];
+        int pos = cursor.load(std::memory_order_relaxed);
+        if (currentMode == Mode::ARMED) {
+            auto numSamples = buffer.getNumSamples();
+            // so that the recording can include what came before its trigger
+            preRoll.write(readL, readR, numSamples);
+            auto triggerIndex = trigger.find(readL, readR, numSamples, midi);
+            if (triggerIndex >= 0) {
+                entry.sampleRate = sampleRate;
+                currentMode = Mode::RECORDING;
+                // the rest of the block is already in the pre-roll buffer (only its end if the block is larger)
+                auto numAvailable = preRoll.getNumAvailable();
+                auto numAfterTrigger = std::min(numSamples - triggerIndex, numAvailable);
+                auto numPreRoll = juce::jlimit(0,
+                                               std::max(0, numAvailable - numAfterTrigger),
+                                               (int)(trigger.getSpec().preRollSeconds * sampleRate));
+                preRoll.readLast(numPreRoll + numAfterTrigger, [&](const float *l, const float *r, int size) {
+                    auto written = append(entry, l, r, size);
+                    pos += written;
+                    if (written < size) {
+                        currentMode = Mode::WAITING;
+                    }
+                });
+                if (currentMode == Mode::WAITING) {
+                    pos = 0;
                 }
-                if (cursor == 0 && readL[i] == 0 && readR[i] == 0) {
-                    continue;
-                }
-                entry.dataL[cursor] = readL[i];
-                entry.dataR[cursor] = readR[i];
-                cursor++;
             }
-        } else if (mode == Mode::PLAYING) {
-            // if (entry.sampleRate != sampleRate) {
-            //     continue;
-            // }
-            auto &targetL = filterEnabled ? filteredL : entry.dataL;
-            auto &targetR = filterEnabled ? filteredR : entry.dataR;
-            for (auto i = 0; i < buffer.getNumSamples(); ++i) {
-                if (MAX_REC_SAMPLES <= cursor) {
-                    mode = Mode::WAITING;
-                    cursor = 0;
+        } else if (currentMode == Mode::RECORDING) {
+            entry.sampleRate = sampleRate;
+            auto size = buffer.getNumSamples();
+            auto written = append(entry, readL, readR, size);
+            pos += written;
+            if (written < size) {
+                currentMode = Mode::WAITING;
+                pos = 0;
+            }
+        } else if (currentMode == Mode::PLAYING) {
+            // adds the next `size` samples of the entry (at its own rate)
+            auto render = [&](float *outputL, float *outputR, int size) {
+                if (playFiltered && playFilterType == FilterType::IIR) {
+                    // the cursor waits for the part that has not been rendered yet
+                    pos += renderedPlayback.process(outputL, outputR, size);
+                    return;
                 }
-                if (mode == Mode::WAITING) {
-                    break;
+                if (playFiltered) {
+                    playbackFilter.process(outputL, outputR, size);
+                } else {
+                    entry.storage->addTo(pos, outputL, outputR, size);
                 }
-                writeL[i] += targetL[cursor];
-                writeR[i] += targetR[cursor];
-                cursor++;
+                pos += size;
+            };
+            // the end of the entry is heard `latency` samples after it is rendered
+            int latency = 0;
+            if (entry.sampleRate == sampleRate || !resampler.isPreparedFor(entry.sampleRate, sampleRate)) {
+                auto numSamples = std::max(0, std::min(buffer.getNumSamples(), entry.storage->getNumSamples() - pos));
+                render(writeL, writeR, numSamples);
+            } else {
+                resampler.process(writeL, writeR, buffer.getNumSamples(), [&](float *l, float *r, int size) {
+                    juce::FloatVectorOperations::clear(l, size);
+                    juce::FloatVectorOperations::clear(r, size);
+                    render(l, r, size);
+                });
+                latency = resampler.getLatency();
             }
+            if (entry.storage->getNumSamples() + latency <= pos) {
+                currentMode = Mode::WAITING;
+                pos = 0;
+            }
+        }
+        cursor.store(pos, std::memory_order_relaxed);
+        if (currentMode == Mode::WAITING) {
+            // the pool may be trimmed from now on
+            pool.endAcquiring();
         }
+        // publishes the written samples to the GUI thread
+        mode.store(currentMode, std::memory_order_release);
     }
 
 private:
-    enum class Mode { WAITING, RECORDING, PLAYING };
-    std::mutex mtx;
-    int currentEntryIndex = 0;
-    int cursor = 0;
-    Mode mode = Mode::WAITING;
-
-    bool filterEnabled = false;
-    int filterN = 100;
-    float filterLowFreq = 20;
-    float filterHighFreq = 20000;
-    float filteredL[MAX_REC_SAMPLES]{};
-    float filteredR[MAX_REC_SAMPLES]{};
-
-    void calculateFilter() {
-        auto &entry = entries[currentEntryIndex];
-        auto h = std::vector<double>(filterN + 1, 0.0);
-        {
-            double fc = filterHighFreq / entry.sampleRate;
-            double wc = fc * juce::MathConstants<double>::twoPi;
-            for (int n = 0; n <= filterN; n++) {
-                double n1 = n - (double)filterN / 2;
-                double sinc = n1 == 0 ? 1 : std::sin(wc * n1) / (wc * n1);
-                double value = 2.0 * fc * sinc;
-                // blackman
-                // TODO: 一般化して切り出す
-                double window = 0.42 + 0.5 * std::cos(2 * juce::MathConstants<double>::pi * n1 / filterN) +
-                                0.08 * std::cos(4 * juce::MathConstants<double>::pi * n1 / filterN);
-                h[n] += value * window;
-            }
+    enum class Mode { WAITING, ARMED, RECORDING, PLAYING };
+    enum class CommandType { RECORD, PLAY, STOP };
+    struct Command {
+        CommandType type = CommandType::STOP;
+        int entryIndex = 0;
+        int cursor = 0;
+        bool filterEnabled = false;
+        FilterType filterType = FilterType::FIR;
+        // the request of the IIR render to play
+        int renderGeneration = 0;
+        TriggerSpec trigger;
+    };
+
+    // written by the GUI thread
+    std::atomic<int> currentEntryIndex{0};
+    // written by the audio thread
+    std::atomic<Mode> mode{Mode::WAITING};
+    std::atomic<int> activeEntryIndex{0};
+    std::atomic<int> cursor{0};
+    std::atomic<float> hostSampleRate{48000};
+    // written while the audio thread is not running
+    int maxBlockSize = 0;
+    bool playFiltered = false;
+    FilterType playFilterType = FilterType::FIR;
+    // written by the GUI thread
+    FilterType playingFilterType = FilterType::FIR;
+
+    LockFreeQueue<Command, 32> commands;
+    std::atomic<int> numPendingCommands{0};
+
+    ChunkPool pool;
+    // the take being written or played; replaced (not reused) by each recording, as snapshots may still refer to it
+    struct Entry {
+        float sampleRate = 48000;
+        std::shared_ptr<const RecordingSource> storage;
+        // what `storage` is, for the audio thread to write to (one of them is nullptr)
+        ChunkedRecording *memory = nullptr;
+        DiskRecording *disk = nullptr;
+        // limited by the memory budget when it was recorded
+        bool isCutShort = false;
+    };
+    // written while not operating
+    std::array<Entry, NUM_ENTRIES> entries{};
+    std::array<std::shared_ptr<const EntrySnapshot>, NUM_ENTRIES> snapshots{};
+    std::atomic<uint64_t> generation{0};
+    // written by the GUI thread
+    int recordingEntryIndex = -1;
+    LiveTake liveTake;
+    // entries restored from a state, waiting for the transport to stop
+    struct PendingRestore {
+        float sampleRate;
+        std::vector<float> dataL;
+        std::vector<float> dataR;
+    };
+    std::mutex restoreMutex;
+    std::array<std::unique_ptr<PendingRestore>, NUM_ENTRIES> pendingRestores;
+    // prepared by the GUI thread before playing
+    Resampler resampler;
+    // audio thread while armed; prepared by the GUI thread
+    PreRollBuffer preRoll;
+    TriggerDetector trigger;
+    KernelDesigner kernelDesigner{CONVOLUTION_BLOCK_SIZE};
+    PlaybackFilter playbackFilter{CONVOLUTION_BLOCK_SIZE, MAX_FILTER_SIZE};
+    RenderedPlayback renderedPlayback;
+    FilterDesigner designer{playbackFilter,
+                            renderedPlayback,
+                            [this](const FilterSpec &spec, int generation) { return designFilter(spec, generation); }};
+
+    void sendCommand(const Command &command) {
+        numPendingCommands++;
+        if (!commands.push(command)) {
+            numPendingCommands--;
         }
-        {
-            double fc = filterLowFreq / entry.sampleRate;
-            double wc = fc * juce::MathConstants<double>::twoPi;
-            for (int n = 0; n <= filterN; n++) {
-                double n1 = n - (double)filterN / 2;
-                double sinc = n1 == 0 ? 1 : std::sin(wc * n1) / (wc * n1);
-                double value = 2.0 * fc * sinc;
-                double window = 0.42 + 0.5 * std::cos(2 * juce::MathConstants<double>::pi * n1 / filterN) +
-                                0.08 * std::cos(4 * juce::MathConstants<double>::pi * n1 / filterN);
-                h[n] -= value * window;
-            }
+    }
+    void applyCommand(const Command &command) {
+        switch (command.type) {
+            case CommandType::RECORD:
+                if (mode.load(std::memory_order_relaxed) != Mode::WAITING) {
+                    return;
+                }
+                activeEntryIndex.store(command.entryIndex, std::memory_order_relaxed);
+                cursor.store(0, std::memory_order_relaxed);
+                trigger.reset(command.trigger);
+                pool.beginAcquiring();
+                mode.store(Mode::ARMED, std::memory_order_release);
+                break;
+            case CommandType::PLAY:
+                if (mode.load(std::memory_order_relaxed) != Mode::WAITING) {
+                    return;
+                }
+                activeEntryIndex.store(command.entryIndex, std::memory_order_relaxed);
+                cursor.store(command.cursor, std::memory_order_relaxed);
+                playFiltered = command.filterEnabled;
+                playFilterType = command.filterType;
+                resampler.reset();
+                if (playFiltered && playFilterType == FilterType::IIR) {
+                    renderedPlayback.start(command.cursor, command.renderGeneration);
+                } else if (playFiltered) {
+                    playbackFilter.start(*entries[command.entryIndex].storage, command.cursor);
+                }
+                mode.store(Mode::PLAYING, std::memory_order_release);
+                break;
+            case CommandType::STOP:
+                pool.endAcquiring();
+                mode.store(Mode::WAITING, std::memory_order_release);
+                break;
         }
-        for (int i = 0; i < MAX_REC_SAMPLES; i++) {
-            double sumL = 0;
-            double sumR = 0;
-            for (int n = 0; n <= filterN; n++) {
-                double xl = i - n < 0 ? 0 : entry.dataL[i - n];
-                sumL += h[n] * xl;
-                double xr = i - n < 0 ? 0 : entry.dataR[i - n];
-                sumR += h[n] * xr;
+    }
+
+    // message thread: a take is finished as soon as the audio thread has stopped recording it
+    void timerCallback() override {
+        updateEntries();
+        // the filters the audio thread has let go of (renders hold a copy of a whole entry)
+        playbackFilter.collectGarbage();
+        renderedPlayback.collectGarbage();
+    }
+    // message thread: finishes the last take and applies restored entries, unless operating
+    void updateEntries() {
+        finishRecording();
+        if (!canOperate()) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(restoreMutex);
+        for (int i = 0; i < NUM_ENTRIES; i++) {
+            if (auto restore = std::move(pendingRestores[i])) {
+                auto &entry = entries[i];
+                auto memory = std::make_shared<ChunkedRecording>(pool);
+                memory->restore(restore->dataL.data(),
+                                restore->dataR.data(),
+                                (int)std::min(restore->dataL.size(), restore->dataR.size()));
+                entry.sampleRate = restore->sampleRate;
+                entry.memory = memory.get();
+                entry.disk = nullptr;
+                entry.isCutShort = false;
+                entry.storage = std::move(memory);
+                publish(i, ++generation);
             }
-            filteredL[i] = sumL;
-            filteredR[i] = sumR;
         }
     }
+
+    // non-audio thread, while not operating
+    void publish(int entryIndex, uint64_t snapshotGeneration) {
+        auto &entry = entries[entryIndex];
+        std::atomic_store(&snapshots[entryIndex],
+                          std::make_shared<const EntrySnapshot>(
+                              snapshotGeneration, entry.sampleRate, entry.disk != nullptr, entry.storage));
+    }
+    void setEmpty(int entryIndex) {
+        auto &entry = entries[entryIndex];
+        auto memory = std::make_shared<ChunkedRecording>(pool);
+        entry.memory = memory.get();
+        entry.disk = nullptr;
+        entry.isCutShort = false;
+        entry.storage = std::move(memory);
+        publish(entryIndex, ++generation);
+    }
+    // audio thread: returns the number of samples taken
+    int append(Entry &entry, const float *sourceL, const float *sourceR, int size) {
+        return entry.disk != nullptr ? entry.disk->append(sourceL, sourceR, size)
+                                     : entry.memory->append(sourceL, sourceR, size);
+    }
+    void getOpenEdges(const FilterSpec &filter, float sampleRate, float &lowFreq, float &highFreq) {
+        // edges at the ends of the range are left open rather than filtering (and paying for) the extremes
+        auto nyquist = sampleRate / 2;
+        lowFreq = filter.lowFreq <= MIN_FILTER_FREQ ? 0.0f : filter.lowFreq;
+        highFreq = filter.highFreq >= std::min(MAX_FILTER_FREQ, nyquist) ? nyquist : filter.highFreq;
+    }
+    DesignedFilter designFilter(const FilterSpec &spec, int generation) {
+        if (spec.type == FilterType::FIR) {
+            return DesignedFilter{kernelDesigner.design(resolveFilter(spec)), nullptr};
+        }
+        // zero phase needs what comes after each sample, so the entry is rendered ahead of the cursor
+        auto entry = getSnapshot(spec.entryIndex);
+        auto start = juce::jlimit(0, entry->getNumSamples(), spec.position);
+        return DesignedFilter{
+            nullptr, std::make_shared<FilteredRender>(std::move(entry), resolveIirFilter(spec), start, generation)};
+    }
 };
 
 //==============================================================================
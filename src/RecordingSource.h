@@ -0,0 +1,16 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+// Read access to a recorded stereo take, wherever it is stored.
+// Ranges may go beyond the recording; the outside is silence.
+class RecordingSource {
+public:
+    virtual ~RecordingSource() {}
+    virtual int getNumSamples() const = 0;
+    // copies [start, start + size)
+    virtual void read(int start, float *destinationL, float *destinationR, int size) const = 0;
+    // audio thread: adds [start, start + size) to the output
+    virtual void addTo(int start, float *outputL, float *outputR, int size) const = 0;
+};
@@ -0,0 +1,75 @@
+#include "Resampler.h"
+
+#include "FilterDesign.h"
+
+namespace {
+// per side at the source rate when upsampling
+constexpr int HALF_TAPS = 32;
+constexpr float ATTENUATION = 80.0f;
+}  // namespace
+
+//==============================================================================
+bool Resampler::prepare(double sourceRate, double targetRate) {
+    constexpr auto pi = juce::MathConstants<double>::pi;
+    preparedSourceRate = sourceRate;
+    preparedTargetRate = targetRate;
+    ratio = sourceRate / targetRate;
+    if (!(ratio > 0 && ratio <= maxRatio)) {
+        numTaps = 0;
+        return false;
+    }
+    // stretched with the lower cutoff when downsampling, for the same transition band at the target rate
+    numTaps = 2 * (int)std::ceil(HALF_TAPS * std::max(1.0, ratio));
+    // Kaiser's estimate of the transition width for this length, in cycles per source sample; the stopband starts at
+    // the lower Nyquist frequency
+    auto transition = (ATTENUATION - 7.95) / (2.285 * numTaps * 2 * pi);
+    auto cutoff = 0.5 * std::min(1.0, 1.0 / ratio) - transition / 2;
+    auto beta = KernelDesigner::kaiserBetaFor(ATTENUATION);
+    table.resize((numPhases + 1) * numTaps);
+    for (int p = 0; p <= numPhases; p++) {
+        for (int k = 0; k < numTaps; k++) {
+            // from the output position to the tap
+            double t = k - numTaps / 2 + 1 - (double)p / numPhases;
+            auto x = 2 * cutoff * t;
+            auto sinc = x == 0 ? 1.0 : std::sin(pi * x) / (pi * x);
+            table[p * numTaps + k] = (float)(2 * cutoff * sinc * KernelDesigner::kaiser(t / numTaps, beta));
+        }
+    }
+    kernel.assign(numTaps, 0.0f);
+    historyL.assign(numTaps + blockSize * maxRatio + 2, 0.0f);
+    historyR.assign(historyL.size(), 0.0f);
+    reset();
+    return true;
+}
+void Resampler::reset() {
+    if (numTaps == 0) {
+        return;
+    }
+    // the first output is centred on the first input
+    numFilled = numTaps / 2 - 1;
+    position = numFilled;
+    std::fill(historyL.begin(), historyL.begin() + numFilled, 0.0f);
+    std::fill(historyR.begin(), historyR.begin() + numFilled, 0.0f);
+}
+bool Resampler::convert(std::vector<float> &dataL, std::vector<float> &dataR, double sourceRate, double targetRate) {
+    Resampler resampler;
+    if (!resampler.prepare(sourceRate, targetRate)) {
+        return false;
+    }
+    auto numInput = (int)std::min(dataL.size(), dataR.size());
+    auto numOutput = (int)std::round(numInput / resampler.ratio);
+    std::vector<float> outputL(numOutput);
+    std::vector<float> outputR(numOutput);
+    int read = 0;
+    resampler.process(outputL.data(), outputR.data(), numOutput, [&](float *l, float *r, int size) {
+        auto length = juce::jlimit(0, size, numInput - read);
+        std::copy(dataL.begin() + read, dataL.begin() + read + length, l);
+        std::copy(dataR.begin() + read, dataR.begin() + read + length, r);
+        std::fill(l + length, l + size, 0.0f);
+        std::fill(r + length, r + size, 0.0f);
+        read += size;
+    });
+    dataL = std::move(outputL);
+    dataR = std::move(outputR);
+    return true;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+// Streaming stereo sample rate converter with a Kaiser-windowed sinc.
+// The kernel is tabulated at numPhases fractional offsets when the rates are set. Each output sample blends two
+// neighbouring rows and takes dot products with the input history, so only vectorised multiply-adds run per sample.
+// When downsampling, the cutoff is lowered below the target Nyquist frequency.
+class Resampler {
+public:
+    enum { numPhases = 256, maxRatio = 8, blockSize = 256 };
+
+    Resampler(){};
+    ~Resampler(){};
+    Resampler(const Resampler &) = delete;
+
+    // non-audio thread, while not processing: false if the ratio is beyond maxRatio
+    bool prepare(double sourceRate, double targetRate);
+    bool isPreparedFor(double sourceRate, double targetRate) const {
+        return numTaps > 0 && sourceRate == preparedSourceRate && targetRate == preparedTargetRate;
+    }
+    // how far (in source samples) the input is pulled ahead of the output
+    int getLatency() const { return numTaps / 2; }
+
+    // audio thread: starts over with silence before the next input
+    void reset();
+    // audio thread: adds `numSamples` samples at the target rate to the output, calling pull(l, r, size) to fill the
+    // next `size` samples at the source rate
+    template <typename F>
+    void process(float *outputL, float *outputR, int numSamples, F &&pull) {
+        auto half = numTaps / 2;
+        for (int done = 0; done < numSamples;) {
+            auto size = std::min(numSamples - done, (int)blockSize);
+            // up to the last tap of the last output in this block
+            auto needed = (int)(position + (size - 1) * ratio) + half + 1;
+            if (needed > numFilled) {
+                pull(historyL.data() + numFilled, historyR.data() + numFilled, needed - numFilled);
+                numFilled = needed;
+            }
+            for (int i = 0; i < size; i++) {
+                auto base = (int)position;
+                auto phase = (float)(position - base) * numPhases;
+                auto row = std::min((int)phase, numPhases - 1);
+                auto alpha = phase - row;
+                auto *taps = table.data() + row * numTaps;
+                juce::FloatVectorOperations::copyWithMultiply(kernel.data(), taps, 1.0f - alpha, numTaps);
+                juce::FloatVectorOperations::addWithMultiply(kernel.data(), taps + numTaps, alpha, numTaps);
+                auto start = base - half + 1;
+                outputL[done + i] += dot(kernel.data(), historyL.data() + start, numTaps);
+                outputR[done + i] += dot(kernel.data(), historyR.data() + start, numTaps);
+                position += ratio;
+            }
+            // drops what the next output no longer needs
+            auto consumed = (int)position - half + 1;
+            std::copy(historyL.begin() + consumed, historyL.begin() + numFilled, historyL.begin());
+            std::copy(historyR.begin() + consumed, historyR.begin() + numFilled, historyR.begin());
+            numFilled -= consumed;
+            position -= consumed;
+            done += size;
+        }
+    }
+
+    // non-audio thread: converts a whole recording, false if the ratio is not supported
+    static bool convert(std::vector<float> &dataL, std::vector<float> &dataR, double sourceRate, double targetRate);
+
+private:
+    double preparedSourceRate = 0;
+    double preparedTargetRate = 0;
+    // source samples per output sample
+    double ratio = 1;
+    int numTaps = 0;
+    // numPhases + 1 rows of numTaps, the last one for blending with the first phase of the next sample
+    std::vector<float> table;
+    std::vector<float> kernel;
+    std::vector<float> historyL;
+    std::vector<float> historyR;
+    int numFilled = 0;
+    // of the next output sample, in history samples
+    double position = 0;
+
+    static float dot(const float *a, const float *b, int n) {
+        // independent partial sums, so that the compiler can keep them in vector registers
+        float sums[8]{};
+        int i = 0;
+        for (; i + 8 <= n; i += 8) {
+            for (int j = 0; j < 8; j++) {
+                sums[j] += a[i + j] * b[i + j];
+            }
+        }
+        for (; i < n; i++) {
+            sums[0] += a[i] * b[i];
+        }
+        return ((sums[0] + sums[1]) + (sums[2] + sums[3])) + ((sums[4] + sums[5]) + (sums[6] + sums[7]));
+    }
+};
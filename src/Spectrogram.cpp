@@ -0,0 +1,280 @@
+#include "Spectrogram.h"
+
+//==============================================================================
+class SpectrogramCalculator::Worker : public juce::Thread {
+public:
+    Worker(SpectrogramCalculator &owner) : juce::Thread("Spectrogram Worker"), owner(owner) { startThread(); }
+    ~Worker() override {
+        signalThreadShouldExit();
+        notify();
+        stopThread(1000);
+    }
+
+    // only while not busy
+    void prepare(const SpectrogramSpec &spec, const std::vector<Band> &bands) {
+        // an FFT for each size the bands use
+        for (int order = minFftOrder; order <= maxFftOrder; order++) {
+            auto &fft = ffts[order - minFftOrder];
+            auto isUsed =
+                std::any_of(bands.begin(), bands.end(), [&](const Band &band) { return band.fftOrder == order; });
+            if (!isUsed) {
+                fft = nullptr;
+            } else if (fft == nullptr) {
+                fft = StereoFft::create(order);
+            }
+        }
+        // large enough for the longest band
+        left.resize(1 << spec.fftOrder);
+        right.resize(1 << spec.fftOrder);
+        for (int i = 0; i < StereoFft::numChannels; i++) {
+            magnitudes[i].resize((1 << (spec.fftOrder - 1)) + 1);
+            magnitudePointers[i] = magnitudes[i].data();
+        }
+        mapped.resize(spec.numBins);
+    }
+
+    // indexed by fftOrder - minFftOrder
+    std::unique_ptr<StereoFft> ffts[maxFftOrder - minFftOrder + 1];
+    std::vector<float> left;
+    std::vector<float> right;
+    std::vector<float> magnitudes[StereoFft::numChannels];
+    float *magnitudePointers[StereoFft::numChannels]{};
+    std::vector<float> mapped;
+    // columns left to this worker
+    std::mutex mutex;
+    int begin = 0;
+    int end = 0;
+
+private:
+    SpectrogramCalculator &owner;
+
+    void run() override {
+        while (!threadShouldExit()) {
+            owner.work(*this);
+            wait(-1);
+        }
+    }
+};
+
+//==============================================================================
+SpectrogramCalculator::SpectrogramCalculator(const SpectrogramSpec &spec, int numWorkers) {
+    for (int i = 0; i < std::max(1, numWorkers); i++) {
+        workers.push_back(std::make_unique<Worker>(*this));
+    }
+    configure(spec);
+}
+SpectrogramCalculator::~SpectrogramCalculator() {
+    // no worker may be looking at the others while they are destroyed
+    cancelled = true;
+    while (numBusy.load() > 0) {
+        std::this_thread::yield();
+    }
+    workers.clear();
+}
+void SpectrogramCalculator::configure(const SpectrogramSpec &newSpec) {
+    cancel();
+    source = nullptr;
+    spec = newSpec;
+    spec.fftOrder = juce::jlimit((int)minFftOrder, (int)maxFftOrder, spec.fftOrder);
+    spec.numColumns = std::max(1, spec.numColumns);
+    levels.assign(spec.numColumns * spec.numBins, 0);
+    ready.reset(new std::atomic<bool>[spec.numColumns]);
+    for (int i = 0; i < spec.numColumns; i++) {
+        ready[i] = false;
+    }
+    numReady = 0;
+    // halving down to the smallest size; which bins each band takes depends on the sample rate
+    auto numBands = spec.multiResolution ? std::min((int)maxNumBands, spec.fftOrder - minFftOrder + 1) : 1;
+    bands.resize(numBands);
+    for (int i = 0; i < numBands; i++) {
+        auto &band = bands[i];
+        band.fftOrder = spec.fftOrder - i;
+        auto fftSize = 1 << band.fftOrder;
+        band.window.resize(fftSize);
+        juce::dsp::WindowingFunction<float>::fillWindowingTables(band.window.data(), fftSize, spec.window, true);
+    }
+    for (auto &worker : workers) {
+        worker->prepare(spec, bands);
+    }
+}
+void SpectrogramCalculator::start(std::shared_ptr<const RecordingSource> newSource,
+                                  float newSampleRate,
+                                  int newLength) {
+    cancel();
+    source = std::move(newSource);
+    sampleRate = newSampleRate;
+    length = newLength;
+    prepareBands();
+    for (int i = 0; i < spec.numColumns; i++) {
+        ready[i].store(false, std::memory_order_relaxed);
+    }
+    numReady = 0;
+    cancelled = false;
+    update();
+}
+void SpectrogramCalculator::saveTo(CachedSpectrogram &cache, uint64_t generation) const {
+    if (getNumReady() < spec.numColumns) {
+        return;
+    }
+    cache.generation = generation;
+    cache.sampleRate = sampleRate;
+    cache.spec = spec;
+    cache.levels = levels;
+}
+bool SpectrogramCalculator::restoreFrom(const CachedSpectrogram &cache, uint64_t generation, float newSampleRate) {
+    if (cache.generation != generation || cache.sampleRate != newSampleRate || cache.spec != spec) {
+        return false;
+    }
+    cancel();
+    // nothing left for the workers
+    source = nullptr;
+    sampleRate = newSampleRate;
+    std::copy(cache.levels.begin(), cache.levels.end(), levels.begin());
+    for (int i = 0; i < spec.numColumns; i++) {
+        ready[i].store(true, std::memory_order_relaxed);
+    }
+    numReady.store(spec.numColumns, std::memory_order_release);
+    return true;
+}
+void SpectrogramCalculator::cancel() {
+    // a busy worker finishes the column at hand and then sees the cancellation
+    cancelled = true;
+    while (numBusy.load() > 0) {
+        std::this_thread::yield();
+    }
+    for (auto &worker : workers) {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        worker->begin = 0;
+        worker->end = 0;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    limit = 0;
+    nextColumn = 0;
+}
+void SpectrogramCalculator::prepareBands() {
+    // bin i is at minFreq * ratio^i, and a band resolves the bins whose spacing is at least its own
+    auto ratio = std::pow(spec.maxFreq / spec.minFreq, 1.0f / spec.numBins);
+    auto endBin = spec.numBins;
+    for (int i = (int)bands.size() - 1; i >= 0; i--) {
+        auto &band = bands[i];
+        auto firstBin = 0;
+        if (i > 0) {
+            auto minFreq = sampleRate / (1 << band.fftOrder) / (ratio - 1);
+            firstBin = juce::jlimit(0, endBin, (int)std::ceil(std::log(minFreq / spec.minFreq) / std::log(ratio)));
+        }
+        band.firstBin = firstBin;
+        band.frequencyMap.prepare(1 << band.fftOrder,
+                                  sampleRate,
+                                  spec.minFreq * std::pow(ratio, (float)firstBin),
+                                  spec.minFreq * std::pow(ratio, (float)endBin),
+                                  endBin - firstBin);
+        endBin = firstBin;
+    }
+}
+void SpectrogramCalculator::update() {
+    if (source == nullptr) {
+        return;
+    }
+    auto numWritten = source->getNumSamples();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto oldLimit = limit;
+        while (limit < spec.numColumns && getSampleIndex(limit) <= numWritten) {
+            limit++;
+        }
+        if (limit == oldLimit) {
+            return;
+        }
+    }
+    for (auto &worker : workers) {
+        worker->notify();
+    }
+}
+void SpectrogramCalculator::work(Worker &worker) {
+    numBusy++;
+    int column;
+    while (!cancelled.load() && takeColumn(worker, column)) {
+        calculateColumn(worker, column);
+        ready[column].store(true, std::memory_order_release);
+        numReady.fetch_add(1, std::memory_order_release);
+    }
+    numBusy--;
+}
+bool SpectrogramCalculator::takeColumn(Worker &worker, int &column) {
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.begin < worker.end) {
+            column = worker.begin++;
+            return true;
+        }
+    }
+    {
+        // a fair share of what is left, so that the others get some as well
+        std::lock_guard<std::mutex> lock(mutex);
+        auto numLeft = limit - nextColumn;
+        if (numLeft > 0) {
+            auto size = std::max(1, numLeft / (int)workers.size());
+            column = nextColumn;
+            nextColumn += size;
+            std::lock_guard<std::mutex> workerLock(worker.mutex);
+            worker.begin = column + 1;
+            worker.end = column + size;
+            return true;
+        }
+    }
+    while (true) {
+        Worker *victim = nullptr;
+        int largest = 0;
+        for (auto &other : workers) {
+            std::lock_guard<std::mutex> lock(other->mutex);
+            if (other->end - other->begin > largest) {
+                largest = other->end - other->begin;
+                victim = other.get();
+            }
+        }
+        if (victim == nullptr) {
+            return false;
+        }
+        int begin, end;
+        {
+            std::lock_guard<std::mutex> lock(victim->mutex);
+            if (victim->begin >= victim->end) {
+                // taken in the meantime
+                continue;
+            }
+            end = victim->end;
+            begin = end - (end - victim->begin + 1) / 2;
+            victim->end = begin;
+        }
+        column = begin;
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.begin = begin + 1;
+        worker.end = end;
+        return true;
+    }
+}
+void SpectrogramCalculator::calculateColumn(Worker &worker, int column) {
+    auto *left = worker.left.data();
+    auto *right = worker.right.data();
+    auto *mapped = worker.mapped.data();
+    // the longest frame ends at the column, and the others share its centre
+    int centre = getSampleIndex(column) - (1 << spec.fftOrder) / 2;
+    for (auto &band : bands) {
+        if (band.frequencyMap.getNumBins() == 0) {
+            continue;
+        }
+        auto fftSize = 1 << band.fftOrder;
+        source->read(centre - fftSize / 2, left, right, fftSize);
+        juce::FloatVectorOperations::multiply(left, band.window.data(), fftSize);
+        juce::FloatVectorOperations::multiply(right, band.window.data(), fftSize);
+        worker.ffts[band.fftOrder - minFftOrder]->performFrequencyOnlyForwardTransform(
+            left, right, worker.magnitudePointers);
+        band.frequencyMap.map(
+            worker.magnitudes[(int)spec.channel].data(), mapped + band.firstBin, spec.mindB, spec.maxdB);
+    }
+    auto *columnLevels = levels.data() + column * spec.numBins;
+    for (int i = 0; i < spec.numBins; i++) {
+        // rounded, as the mapped levels are within 0..1
+        columnLevels[i] = (Level)(mapped[i] * maxLevel + 0.5f);
+    }
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "Fft.h"
+#include "LogFrequencyMap.h"
+#include "RecordingSource.h"
+
+//==============================================================================
+struct SpectrogramSpec {
+    // spread evenly over the take, so the hop is its length divided by this
+    int numColumns = 1024;
+    int numBins = 512;
+    // 8 (256) to 15 (32768)
+    int fftOrder = 12;
+    juce::dsp::WindowingFunction<float>::WindowingMethod window = juce::dsp::WindowingFunction<float>::hann;
+    // higher bins from shorter frames, down to fftOrder - 3, wherever they still resolve the bins
+    bool multiResolution = false;
+    // the one kept of the channels each frame is analysed into
+    StereoChannel channel = StereoChannel::MID;
+    // bins are spaced logarithmically between these
+    float minFreq = 20;
+    float maxFreq = 20000;
+    // mapped to levels 0..maxLevel
+    float mindB = -100;
+    float maxdB = 0;
+
+    bool operator==(const SpectrogramSpec &other) const {
+        return numColumns == other.numColumns && numBins == other.numBins && fftOrder == other.fftOrder &&
+               window == other.window && multiResolution == other.multiResolution && channel == other.channel &&
+               minFreq == other.minFreq && maxFreq == other.maxFreq && mindB == other.mindB && maxdB == other.maxdB;
+    }
+    bool operator!=(const SpectrogramSpec &other) const { return !(*this == other); }
+};
+
+//==============================================================================
+// A finished spectrogram kept aside, with what it was calculated from.
+struct CachedSpectrogram {
+    // of the snapshot; 0 while empty
+    uint64_t generation = 0;
+    float sampleRate = 0;
+    SpectrogramSpec spec;
+    std::vector<uint8_t> levels;
+};
+
+//==============================================================================
+// Calculates the columns of a spectrogram of a recording on worker threads, one per core.
+// Each frame goes through a StereoFft, of which only the channel of the spec is kept; another channel is another
+// calculation. Every worker has its own FFT and buffers. An idle worker takes a share of the columns nobody has
+// started, or steals the back half of the largest range another worker has left, so that all cores stay busy until
+// the end.
+// Columns are published one by one as they are done. A recording that is still being written is calculated as it
+// grows: a column becomes available as soon as its window has been written.
+// The FFT size, window, channel and number of columns can be changed between calculations.
+// In multi-resolution mode the bins are split into bands by frequency, each calculated from a frame centred on the same
+// sample: the lowest band from a frame of the full FFT size, and each band above from one half as long, as long as
+// its bin spacing is still finer than that of the bins. The higher octaves get sharper in time, and the bands together
+// cost less than two transforms of the full size.
+class SpectrogramCalculator {
+public:
+    // levels are quantized to a byte per bin, as many steps as the heat map can show
+    using Level = uint8_t;
+    enum { maxLevel = 255, minFftOrder = 8, maxFftOrder = 15, maxNumBands = 4 };
+
+    SpectrogramCalculator(const SpectrogramSpec &spec, int numWorkers = juce::SystemStats::getNumCpus());
+    ~SpectrogramCalculator();
+    SpectrogramCalculator(const SpectrogramCalculator &) = delete;
+
+    const SpectrogramSpec &getSpec() const { return spec; }
+    // GUI thread: cancels the calculation in progress and clears all columns
+    void configure(const SpectrogramSpec &spec);
+    // GUI thread: cancels the calculation in progress and starts over for `source`
+    void start(std::shared_ptr<const RecordingSource> source, float sampleRate) {
+        auto length = source->getNumSamples();
+        start(std::move(source), sampleRate, length);
+    }
+    // GUI thread: same for a source that is still being written and will be `length` samples long
+    void start(std::shared_ptr<const RecordingSource> source, float sampleRate, int length);
+    // GUI thread: makes the columns written since the last call available to the workers
+    void update();
+    // GUI thread: keeps the levels aside once all columns are ready
+    void saveTo(CachedSpectrogram &cache, uint64_t generation) const;
+    // GUI thread: cancels the calculation in progress and takes the levels of `cache` if it was calculated from the
+    // same generation with the same settings, false if not
+    bool restoreFrom(const CachedSpectrogram &cache, uint64_t generation, float sampleRate);
+    int getNumReady() const { return numReady.load(std::memory_order_acquire); }
+    bool isReady(int column) const { return ready[column].load(std::memory_order_acquire); }
+    // numBins levels from the lowest frequency, only valid once isReady(column)
+    const Level *getColumn(int column) const { return levels.data() + column * spec.numBins; }
+    // 0..1
+    float getLevel(int column, int bin) const { return getColumn(column)[bin] * (1.0f / maxLevel); }
+
+private:
+    class Worker;
+
+    // bins calculated with the same FFT size, from the longest frame
+    struct Band {
+        int fftOrder = 0;
+        // of the FFT size
+        std::vector<float> window;
+        // for bins from firstBin on; none if the band is not needed at this sample rate
+        int firstBin = 0;
+        LogFrequencyMap frequencyMap;
+    };
+
+    SpectrogramSpec spec;
+    std::vector<Band> bands;
+    std::vector<Level> levels;
+    std::unique_ptr<std::atomic<bool>[]> ready;
+    std::atomic<int> numReady{0};
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    // only replaced while no worker is busy
+    std::shared_ptr<const RecordingSource> source;
+    float sampleRate = 48000;
+    int length = 0;
+    std::atomic<bool> cancelled{true};
+    std::atomic<int> numBusy{0};
+    // columns before `limit` can be calculated; nobody has started those from `nextColumn`
+    std::mutex mutex;
+    int limit = 0;
+    int nextColumn = 0;
+
+    void cancel();
+    void prepareBands();
+    int getSampleIndex(int column) const { return (int)((double)column / spec.numColumns * length); }
+    void work(Worker &worker);
+    bool takeColumn(Worker &worker, int &column);
+    void calculateColumn(Worker &worker, int column);
+};
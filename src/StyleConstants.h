@@ -24,6 +24,7 @@ const juce::Colour CONTROLLED = juce::Colour(170, 170, 170);
 const juce::Colour ANALYSER_BACKGROUND = juce::Colour(200, 200, 200);
 const juce::Colour ANALYSER_BORDER = juce::Colour(150, 150, 150);
 const juce::Colour ANALYSER_LINE = juce::Colour(20, 40, 70);
+const juce::Colour ANALYSER_SIDE_LINE = juce::Colour(130, 140, 160);
 const juce::Colour ENVELOPE_LINE = juce::Colour(255, 200, 200);
 const juce::Colour SPECTRUM_LINE = juce::Colour(200, 255, 200);
 const juce::Colour GUIDE_LINE = juce::Colour(80, 80, 80);
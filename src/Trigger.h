@@ -0,0 +1,153 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+enum class TriggerMode { LEVEL, ONSET, MIDI };
+
+struct TriggerSpec {
+    TriggerMode mode = TriggerMode::LEVEL;
+    // linear peak the input must exceed; 0 triggers on the first sound
+    float threshold = 0;
+    // seconds kept from before the trigger
+    float preRollSeconds = 0;
+};
+
+//==============================================================================
+// Finds where a recording should start in a block of input.
+// Each block is first reduced to peaks of short frames with juce::FloatVectorOperations; only the frame that crosses
+// is scanned sample by sample, so quiet blocks cost a vectorised min/max and no per-sample branches.
+class TriggerDetector {
+public:
+    enum { frameSize = 64 };
+
+    TriggerDetector(){};
+    ~TriggerDetector(){};
+
+    const TriggerSpec &getSpec() const { return spec; }
+    // audio thread
+    void reset(const TriggerSpec &newSpec) {
+        spec = newSpec;
+        envelope = 0;
+        hasEnvelope = false;
+    }
+    // audio thread: index of the first triggering sample in the block, or -1
+    int find(const float *inputL, const float *inputR, int numSamples, const juce::MidiBuffer &midi) {
+        if (numSamples <= 0) {
+            return -1;
+        }
+        if (spec.mode == TriggerMode::MIDI) {
+            for (const auto metadata : midi) {
+                if (metadata.getMessage().isNoteOn()) {
+                    return juce::jlimit(0, numSamples - 1, metadata.samplePosition);
+                }
+            }
+            return -1;
+        }
+        for (int start = 0; start < numSamples; start += frameSize) {
+            auto length = std::min((int)frameSize, numSamples - start);
+            auto peak = std::max(getPeak(inputL + start, length), getPeak(inputR + start, length));
+            if (spec.mode == TriggerMode::ONSET) {
+                // the first frame has nothing to jump from
+                if (!hasEnvelope) {
+                    envelope = peak;
+                    hasEnvelope = true;
+                    continue;
+                }
+                // a jump of the frame peak over the decaying peak of the previous frames
+                auto isOnset = peak > spec.threshold && peak > envelope * ONSET_RATIO;
+                envelope = std::max(peak, envelope * ENVELOPE_DECAY);
+                if (isOnset) {
+                    return start;
+                }
+            } else if (peak > spec.threshold) {
+                for (int i = start; i < start + length; i++) {
+                    if (std::abs(inputL[i]) > spec.threshold || std::abs(inputR[i]) > spec.threshold) {
+                        return i;
+                    }
+                }
+            }
+        }
+        return -1;
+    }
+
+private:
+    // +12 dB
+    static constexpr float ONSET_RATIO = 4.0f;
+    // per frame, about -0.5 dB
+    static constexpr float ENVELOPE_DECAY = 0.94f;
+
+    TriggerSpec spec;
+    float envelope = 0;
+    bool hasEnvelope = false;
+
+    static float getPeak(const float *data, int numSamples) {
+        auto range = juce::FloatVectorOperations::findMinAndMax(data, numSamples);
+        return std::max(-range.getStart(), range.getEnd());
+    }
+};
+
+//==============================================================================
+// The most recent input, kept while a recording is armed so that it can start before its trigger.
+// Sized by prepare() and freed by release() while the audio thread is not using it, then written and read only by the
+// audio thread.
+class PreRollBuffer {
+public:
+    PreRollBuffer(){};
+    ~PreRollBuffer(){};
+    PreRollBuffer(const PreRollBuffer &) = delete;
+
+    // keeps at least the last `numSamples` samples, and forgets what was written before
+    void prepare(int numSamples) {
+        capacity = juce::nextPowerOfTwo(std::max(1, numSamples));
+        dataL.assign(capacity, 0.0f);
+        dataR.assign(capacity, 0.0f);
+        position = 0;
+    }
+    void release() {
+        capacity = 0;
+        dataL = std::vector<float>();
+        dataR = std::vector<float>();
+        position = 0;
+    }
+    // number of samples that can be read back
+    int getNumAvailable() const { return (int)std::min(position, (uint64_t)capacity); }
+    void write(const float *sourceL, const float *sourceR, int numSamples) {
+        if (capacity == 0) {
+            return;
+        }
+        if (numSamples > capacity) {
+            // only the end of the block can be kept
+            auto skip = numSamples - capacity;
+            sourceL += skip;
+            sourceR += skip;
+            position += skip;
+            numSamples = capacity;
+        }
+        auto start = (int)(position & (capacity - 1));
+        auto size1 = std::min(numSamples, capacity - start);
+        juce::FloatVectorOperations::copy(dataL.data() + start, sourceL, size1);
+        juce::FloatVectorOperations::copy(dataR.data() + start, sourceR, size1);
+        juce::FloatVectorOperations::copy(dataL.data(), sourceL + size1, numSamples - size1);
+        juce::FloatVectorOperations::copy(dataR.data(), sourceR + size1, numSamples - size1);
+        position += numSamples;
+    }
+    // calls f(l, r, size) for the (up to two) contiguous parts of the last `numSamples` samples, oldest first
+    template <typename F>
+    void readLast(int numSamples, F &&f) const {
+        auto from = position - (uint64_t)numSamples;
+        auto start = (int)(from & (capacity - 1));
+        auto size1 = std::min(numSamples, capacity - start);
+        f(dataL.data() + start, dataR.data() + start, size1);
+        if (size1 < numSamples) {
+            f(dataL.data(), dataR.data(), numSamples - size1);
+        }
+    }
+
+private:
+    std::vector<float> dataL;
+    std::vector<float> dataR;
+    // a power of two; 0 until prepared
+    int capacity = 0;
+    uint64_t position = 0;
+};
@@ -0,0 +1,90 @@
+#include <JuceHeader.h>
+
+#include "Fft.h"
+
+// Times the stereo FFT of the analysers: JuceStereoFft (juce::dsp::FFT::perform) against SimdStereoFft with each
+// instruction set this build and CPU can run, at every FFT size the analysers use, and checks that they agree.
+namespace {
+const int minOrder = 8;
+const int maxOrder = 15;
+
+// the magnitudes of all channels, one after another
+double measure(StereoFft &fft, std::vector<float> &output) {
+    auto size = fft.getSize();
+    auto numBins = size / 2 + 1;
+    juce::Random random(1);
+    std::vector<float> left(size);
+    std::vector<float> right(size);
+    for (int i = 0; i < size; i++) {
+        left[i] = random.nextFloat() * 2 - 1;
+        right[i] = random.nextFloat() * 2 - 1;
+    }
+    output.resize(StereoFft::numChannels * numBins);
+    float *magnitudes[StereoFft::numChannels];
+    for (int i = 0; i < StereoFft::numChannels; i++) {
+        magnitudes[i] = output.data() + i * numBins;
+    }
+    auto run = [&] { fft.performFrequencyOnlyForwardTransform(left.data(), right.data(), magnitudes); };
+    run();
+    // the same number of samples for every size
+    auto iterations = std::max(100, (1 << 22) / size);
+    auto start = juce::Time::getHighResolutionTicks();
+    for (int i = 0; i < iterations; i++) {
+        run();
+    }
+    auto elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+    return elapsed * 1e6 / iterations;
+}
+float getMaxError(const std::vector<float> &expected, const std::vector<float> &actual) {
+    auto peak = *std::max_element(expected.begin(), expected.end());
+    auto error = 0.0f;
+    for (size_t i = 0; i < expected.size(); i++) {
+        error = std::max(error, std::abs(expected[i] - actual[i]));
+    }
+    return error / peak;
+}
+const char *getName(SimdStereoFft::Instructions instructions) {
+    switch (instructions) {
+        case SimdStereoFft::Instructions::SSE:
+            return "SSE";
+        case SimdStereoFft::Instructions::AVX2:
+            return "AVX2";
+        case SimdStereoFft::Instructions::NEON:
+            return "NEON";
+        default:
+            return "scalar";
+    }
+}
+}  // namespace
+
+int main() {
+    using Instructions = SimdStereoFft::Instructions;
+    std::vector<Instructions> candidates{Instructions::SCALAR};
+    auto best = ComplexSimdFft::getBestInstructions();
+    if (best == Instructions::AVX2) {
+        candidates.push_back(Instructions::SSE);
+    }
+    if (best != Instructions::SCALAR) {
+        candidates.push_back(best);
+    }
+    std::cout << "size    juce (us)";
+    for (auto instructions : candidates) {
+        std::cout << "  simd " << getName(instructions) << " (us, error)";
+    }
+    std::cout << std::endl;
+
+    for (int order = minOrder; order <= maxOrder; order++) {
+        std::vector<float> expected;
+        std::vector<float> actual;
+        JuceStereoFft juceFft(order);
+        auto juceTime = measure(juceFft, expected);
+        std::cout << juce::String(1 << order).paddedRight(' ', 8) << juce::String(juceTime, 2).paddedRight(' ', 11);
+        for (auto instructions : candidates) {
+            SimdStereoFft simdFft(order, instructions);
+            auto simdTime = measure(simdFft, actual);
+            std::cout << "  " << juce::String(simdTime, 2) << " (" << getMaxError(expected, actual) << ")";
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}